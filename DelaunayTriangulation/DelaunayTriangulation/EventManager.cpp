@@ -26,6 +26,7 @@ EventManager::EventManager()
     
   m_mesh.InitMesh(points);
   std::cout << "check Delaunay: " << m_mesh.CheckAllEdge() << "\n";
+  std::cout << "allocation in insertion: " << m_mesh.GetInsertAllocCount() << "\n";
 
   double ave_len = m_mesh.CalcAverateEdgeLength();
   m_mesh.RemoveBoundingFacesWithLongEdge(2.0 * ave_len);
@@ -33,20 +34,9 @@ EventManager::EventManager()
 
 
   //perform centroid volonoi iteration
-  for (int i = 0; i < 30; ++i)
-  {
-    //move each vertex to its volonoi center
-    m_mesh.MoveVertsToVolonoiCenter();
-    
-    //reconstruct mesh 
-    points.clear();
-    for(const auto &v : m_mesh.m_verts) points.push_back({v.x, v.y});
-    m_mesh.InitMesh(points);
-
-    //remove bounding faces
-    m_mesh.RemoveBoundingFacesWithLongEdge(2.0 * ave_len);
-
-  }
+  //(verts are moved in place and the mesh is repaired by flips)
+  delaunay::Index reinserted = m_mesh.LloydRelaxation(30);
+  std::cout << "check Delaunay: " << m_mesh.CheckAllEdge() << " (reinserted " << reinserted << ")\n";
 
 }
 
@@ -60,16 +50,20 @@ void EventManager::DrawScene()
   const std::vector<delaunay::HEFace>& fs = m_mesh.m_faces;
   const std::vector<delaunay::HEVert>& vs = m_mesh.m_verts;
 
+  //verts are relative to the origin of the mesh
+  glPushMatrix();
+  glTranslated(m_mesh.m_origin[0], m_mesh.m_origin[1], 0);
+
   glColor3d(1,1,0);
   glPointSize(8);
   glBegin(GL_POINTS);
-  for(int i = 0; i < vs.size(); ++i)
+  for (delaunay::Index i : m_mesh.Verts())
     glVertex3f( (float)vs[i].x, (float)vs[i].y, 0);
   glEnd();
 
 
   glBegin(GL_LINES);
-  for (int i = 0; i < es.size(); ++i)
+  for (delaunay::Index i : m_mesh.Edges())
   {
     if (es[i].oppo == -1) glColor3d(1,0,0);
     else glColor3d(1,1,1);
@@ -83,7 +77,7 @@ void EventManager::DrawScene()
   //only boundary 
   glBegin(GL_LINES);
   glColor3d(1, 0, 0);
-  for (int i = 0; i < es.size(); ++i)
+  for (delaunay::Index i : m_mesh.Edges())
   {
     if (es[i].oppo != -1) continue;  
     const delaunay::HEVert& v0 = vs[es[i].vert];
@@ -93,6 +87,8 @@ void EventManager::DrawScene()
   }
   glEnd();
 
+  glPopMatrix();
+
 
 
 
@@ -1,9 +1,17 @@
 #include "pch.h"
 #include "delauney.h"
+#include "predicates.h"
 #include <iostream>
 #include <vector>
 #include <array>
-#include <stack>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <cfloat>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 using namespace delaunay;
@@ -29,16 +37,17 @@ static bool Delaunay_solve2by2Eq(
 
 
 //2ӂ̐񓙕̌_S@Oډ~
+template <class V>
 static bool Delaunay_CircumCircle(
-    const HEVert& x0, 
-    const HEVert& x1,
-    const HEVert& x2, 
+    const V& x0, 
+    const V& x1,
+    const V& x2, 
     double &cx, double &cy, double &cr) 
 {
-  double a = x0.x - x1.x;
-  double b = x0.y - x1.y;
-  double c = x1.x - x2.x;
-  double d = x1.y - x2.y;
+  double a = (double)x0.x - x1.x;
+  double b = (double)x0.y - x1.y;
+  double c = (double)x1.x - x2.x;
+  double d = (double)x1.y - x2.y;
 
   double b0 = 0.5 * (x0.NormSq() - x1.NormSq());
   double b1 = 0.5 * (x1.NormSq() - x2.NormSq());
@@ -52,17 +61,26 @@ static bool Delaunay_CircumCircle(
 }
 
 
+//x0 x1 x2 should be counter clockwise 
+//true if p is strictly inside of the circumcircle (exact, see predicates.h)
+template <class V>
 static bool Delaunay_bPointInCircumCircle(
-  const HEVert& x0,
-  const HEVert& x1,
-  const HEVert& x2,
-  const HEVert& p)
+  const V& x0,
+  const V& x1,
+  const V& x2,
+  const V& p)
 {
-  double cx, cy, cr;
-  if (!Delaunay_CircumCircle(x0,x1,x2, cx, cy, cr)) return true; // x0 x1 x2Ȃ crƍl
+  return InCircle(x0.x, x0.y, x1.x, x1.y, x2.x, x2.y, p.x, p.y) > 0;
+}
+
+
+
 
-  double d = (p.x - cx) * (p.x - cx) + (p.y - cy) * (p.y - cy);
-  return d < cr*cr;  
+//returns {(b-a)X(c-a)}.z (its sign is exact, see predicates.h)
+template <class V>
+static double CrossProductZ(const V &a, const V &b, const V &c) 
+{
+  return Orient2d(a.x, a.y, b.x, b.y, c.x, c.y);
 }
 
 
@@ -76,10 +94,9 @@ static void Delaunay_CalcBoundingBox(
 {
   if (points.size() <= 0)return;
 
-  //step1 huge triangle 
   minx = points[0][0], miny = points[0][1];
   maxx = points[0][0], maxy = points[0][1];
-  for (int i = 0; i < (int)points.size(); ++i)
+  for (Index i = 0; i < (Index)points.size(); ++i)
   {
     minx = std::min(points[i][0], minx);
     miny = std::min(points[i][1], miny);
@@ -89,466 +106,3655 @@ static void Delaunay_CalcBoundingBox(
 }
 
 
-void DelaunayMesh::InitMesh(std::vector<std::array<double, 2>>& points)
+//origin of [lo, hi] : its center snapped to a multiple of q (power of two 
+//>= hi - lo). if |o| >= 2q, o/2 <= p <= 2o for all p in [lo, hi] so that 
+//p - o is exact (Sterbenz). otherwise the range is around 0 and o = 0
+static double Delaunay_SnapOrigin(double lo, double hi)
+{
+  int k;
+  std::frexp(std::max(hi - lo, DBL_MIN), &k);
+  const double q = std::ldexp(1.0, k);
+  const double o = std::round(0.5 * (lo + hi) / q) * q;
+  return (std::fabs(o) >= 2 * q) ? o : 0;
+}
+
+
+
+//index on the 2^16 x 2^16 Hilbert curve 
+static unsigned int Delaunay_HilbertKey(unsigned int x, unsigned int y)
+{
+  unsigned int key = 0;
+  for (unsigned int s = 1u << 15; s > 0; s >>= 1)
+  {
+    unsigned int rx = (x & s) > 0;
+    unsigned int ry = (y & s) > 0;
+    key += s * s * ((3 * rx) ^ ry);
+
+    //rotate quadrant
+    if (ry == 0)
+    {
+      if (rx == 1)
+      {
+        x = 0xFFFF - x;
+        y = 0xFFFF - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return key;
+}
+
+
+
+//sort points[idx[begin]] ... points[idx[end-1]] along the Hilbert curve 
+static void Delaunay_HilbertSort(
+  const std::vector<std::array<double, 2>>& points,
+  const double minx, const double miny,
+  const double maxx, const double maxy,
+  const Index begin, const Index end,
+  std::vector<Index>& idx)
+{
+  const double W = std::max(maxx - minx, maxy - miny);
+  const double s = (W > 0) ? 65535.0 / W : 0.0;
+
+  std::vector<std::pair<unsigned int, Index>> keys(end - begin);
+  for (Index i = begin; i < end; ++i)
+  {
+    unsigned int x = (unsigned int)((points[idx[i]][0] - minx) * s);
+    unsigned int y = (unsigned int)((points[idx[i]][1] - miny) * s);
+    keys[i - begin] = { Delaunay_HilbertKey(x, y), idx[i] };
+  }
+  std::sort(keys.begin(), keys.end());
+
+  for (Index i = begin; i < end; ++i) idx[i] = keys[i - begin].second;
+}
+
+
+
+//compute insertion order of points 
+static void Delaunay_CalcInsertOrder(
+  const std::vector<std::array<double, 2>>& points,
+  const double minx, const double miny,
+  const double maxx, const double maxy,
+  const InsertOrder order,
+  std::vector<Index>& idx)
+{
+  const Index N = (Index)points.size();
+  idx.resize(N);
+  for (Index i = 0; i < N; ++i) idx[i] = i;
+
+  if (order == InsertOrder::INPUT) return;
+
+  if (order == InsertOrder::HILBERT)
+  {
+    Delaunay_HilbertSort(points, minx, miny, maxx, maxy, 0, N, idx);
+    return;
+  }
+
+  //fixed seed so that the result is reproducible
+  std::mt19937 rand_engine(0);
+  std::shuffle(idx.begin(), idx.end(), rand_engine);
+  if (order == InsertOrder::RANDOM) return;
+
+  //BRIO : rounds [0,N/2^k), ..., [N/4,N/2), [N/2,N)
+  Index end = N;
+  while (end > 0)
+  {
+    Index begin = (end < 64) ? 0 : end / 2;
+    Delaunay_HilbertSort(points, minx, miny, maxx, maxy, begin, end, idx);
+    end = begin;
+  }
+}
+
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::InitMesh(
+  std::vector<std::array<double, 2>>& points, 
+  InsertOrder order,
+  BuildEngine engine)
 {
   if (points.size() <= 0)return;
 
+  SetOrigin(points);
+  if (engine == BuildEngine::DIVIDE_AND_CONQUER)
+  {
+    std::vector<Vert> local;
+    ToLocal(points, local);
+    InitMeshDivideAndConquer(local);
+    return;
+  }
+
   m_verts.clear();
   m_faces.clear();
   m_edges.clear();
+  m_walk_face = 0;
+  m_convex = true;
+  ClearFreeLists();
+  MarkAllDirty();
+
+  //each insertion adds at most 1 vertex, 2 faces and 6 edges (Euler's 
+  //formula) so that no reallocation happens while inserting
+  m_verts.reserve(points.size());
+  m_faces.reserve(1 + 2 * points.size());
+  m_edges.reserve(3 + 6 * points.size());
+  m_flip_stack.reserve(64);
+  m_insert_alloc_count = 0;
+
+  // step1 add all vertex 
+  // points[i] is stored as m_verts[i] (its edge stays -1 if skipped)
+  ToLocal(points, m_verts);
 
-  // step1 generate huge triangle  
   double minx, miny, maxx, maxy; 
+  std::vector<Index> insert_order;
   Delaunay_CalcBoundingBox(points, minx, miny, maxx, maxy);
-  
-  HEVert v0(minx - 100       , miny - 100, 0);
-  HEVert v1(maxx + 100       , miny - 100, 1);
-  HEVert v2(0.5*(minx + maxx), maxy + 100, 2);
-  HEEdge e0(0, -1, 1, 0);
-  HEEdge e1(1, -1, 2, 0);
-  HEEdge e2(2, -1, 0, 0);
-  HEFace f0(0);
-  m_verts = { v0, v1, v2 };
-  m_edges = { e0, e1, e2 };
-  m_faces = { f0 };
-
-  // Step2 add all vertex 
-  for (int i = 0; i < (int)points.size(); ++i)
-  {
-    AddNewVertex(points[i][0], points[i][1]);
-  }
+  Delaunay_CalcInsertOrder(points, minx, miny, maxx, maxy, order, insert_order);
 
-  // Step2 remove triangles related to (v0, v1,v2)
-  std::vector<std::array<double, 2>> verts;
-  std::vector<std::array<int   , 3>> faces;
+  // step2 first triangle : the first three points (in insertion order) 
+  // that are not collinear. no bounding triangle is needed because points
+  // outside of the mesh are connected to the convex hull
+  if (!InitSeedTriangle(insert_order)) return;
 
-  for (int i = 3; i < (int)m_verts.size(); ++i)
+  // step3 insert the others
+  if (engine == BuildEngine::PARALLEL_INCREMENTAL)
   {
-    verts.push_back({ m_verts[i].x, m_verts[i].y });
+    InsertVertsParallel(insert_order);
   }
-  
-  for (int i = 0; i < (int)m_faces.size(); ++i)
+  else
   {
-    int v0,v1,v2,e0,e1,e2;
-    GetFaceVsEs(i, e0,e1,e2, v0,v1,v2);
-    if (v0 <= 2 || v1 <= 2 || v2 <= 2) continue;
-
-    faces.push_back({v0-3, v1-3, v2-3});
+    for (const auto& v : insert_order) InsertVertex(v);
   }
-  InitByVsFs(verts, faces);
+}
 
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::SetOrigin(const std::vector<std::array<double, 2>>& points)
+{
+  m_origin = {{ 0, 0 }};
+  if (points.empty()) return;
+
+  double minx, miny, maxx, maxy;
+  Delaunay_CalcBoundingBox(points, minx, miny, maxx, maxy);
+  m_origin = {{ Delaunay_SnapOrigin(minx, maxx), Delaunay_SnapOrigin(miny, maxy) }};
 }
 
 
 
-//returns {(b-a)X(c-a)}.z
-static double CrossProductZ(const HEVert &a, const HEVert &b, const HEVert &c) 
+//the rounding to Real is done by storing to Vert (a double -> Real -> double 
+//round trip in registers may be dropped by optimizers)
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::ToLocal(
+  const std::vector<std::array<double, 2>>& points,
+  std::vector<Vert>& verts) const
 {
-  return (b.x - a.x) * (c.y - a.y) - 
-         (b.y - a.y) * (c.x - a.x);
+  verts.clear();
+  verts.reserve(points.size());
+  for (const auto& p : points) 
+    verts.push_back(Vert((Real)(p[0] - m_origin[0]), (Real)(p[1] - m_origin[1])));
 }
 
-static bool isInTriangle(
-    const HEVert& p,
-    const HEVert& v0,
-    const HEVert& v1,
-    const HEVert& v2)
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::ToLocal(
+  const std::vector<std::array<double, 2>>& points,
+  std::vector<std::array<double, 2>>& local) const
 {
-  double d0 = CrossProductZ(v0, v1, p);
-  double d1 = CrossProductZ(v1, v2, p);
-  double d2 = CrossProductZ(v2, v0, p);
-  return (d0 > 0 && d1 > 0 && d2 > 0);
+  local.resize(points.size());
+  for (Index i = 0; i < (Index)points.size(); ++i)
+    local[i] = {{ points[i][0] - m_origin[0], points[i][1] - m_origin[1] }};
 }
 
 
-int DelaunayMesh::SearchFaceCotainPoint(double x, double y)
+
+//make the first face from three verts of order (ccw) and remove them from
+//order. returns false if all verts are collinear (the mesh stays empty)
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::InitSeedTriangle(std::vector<Index>& order)
 {
-  HEVert p(x,y,-1);
+  if (order.empty()) return false;
 
-  for (int i = 0; i < m_faces.size(); ++i)
-  {
-    const HEEdge& e0 = m_edges[m_faces[i].edge];
-    const HEEdge& e1 = m_edges[e0.next];
-    const HEEdge& e2 = m_edges[e1.next];
+  const Vert& p0 = m_verts[order[0]];
+  auto it1 = std::find_if(order.begin() + 1, order.end(), [&](Index v) {
+    return m_verts[v].x != p0.x || m_verts[v].y != p0.y;
+  });
+  if (it1 == order.end()) return false;
 
-    if (isInTriangle(p, m_verts[e0.vert], m_verts[e1.vert], m_verts[e2.vert]))
-      return i;
-  }
+  const Vert& p1 = m_verts[*it1];
+  auto it2 = std::find_if(it1 + 1, order.end(), [&](Index v) {
+    return CrossProductZ(p0, p1, m_verts[v]) != 0;
+  });
+  if (it2 == order.end()) return false;
 
-  return -1;
+  Index vs[3] = { order[0], *it1, *it2 };
+  if (CrossProductZ(p0, p1, m_verts[*it2]) < 0) std::swap(vs[1], vs[2]);
+
+  order.erase(it2);
+  order.erase(it1);
+  order.erase(order.begin());
+
+  m_faces.push_back(Face(0));
+  for (Index i = 0; i < 3; ++i)
+  {
+    m_edges.push_back(Edge(vs[i], -1, (i + 1) % 3, 0));
+    m_verts[vs[i]].edge = i;
+  }
+  return true;
 }
 
 
 
-void DelaunayMesh::AddNewVertex(double x, double y)
+//remove faces/verts flagged as dead and compact arrays in place
+//edges of a removed face are removed, and their twins become boundary (oppo = -1)
+//a remaining vertex whose all faces are removed gets edge = -1
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::RemoveFaces(
+    const std::vector<char>& face_dead,
+    const std::vector<char>& vert_dead)
 {
-  int f0idx = SearchFaceCotainPoint(x,y);
-  if (f0idx < 0) return;
-  //existing triangle  
-  
-  const int e0idx = m_faces[f0idx].edge;
-  const int e1idx = m_edges[e0idx].next;
-  const int e2idx = m_edges[e1idx].next;
-  const int v0idx = m_edges[e0idx].vert;
-  const int v1idx = m_edges[e1idx].vert;
-  const int v2idx = m_edges[e2idx].vert;
-
-  //Add new vertex/face/edge 
-  const int v3idx = (int)m_verts.size();
-  const int f1idx = (int)m_faces.size() + 0;
-  const int f2idx = (int)m_faces.size() + 1;
-  const int e3idx = (int)m_edges.size() + 0, e4idx = (int)m_edges.size() + 1;
-  const int e5idx = (int)m_edges.size() + 2, e6idx = (int)m_edges.size() + 3;
-  const int e7idx = (int)m_edges.size() + 4, e8idx = (int)m_edges.size() + 5;
-
-  m_verts.push_back(HEVert(x, y, e4idx));
-  m_faces.push_back(HEFace(e8idx));
-  m_faces.push_back(HEFace(e6idx));
-
-  m_edges.push_back(HEEdge(v1idx, e8idx, e4idx, f0idx));//e3
-  m_edges.push_back(HEEdge(v3idx, e5idx, e0idx, f0idx));//e4
-  m_edges.push_back(HEEdge(v0idx, e4idx, e6idx, f2idx));//e5
-  m_edges.push_back(HEEdge(v3idx, e7idx, e2idx, f2idx));//e6
-  m_edges.push_back(HEEdge(v2idx, e6idx, e8idx, f1idx));//e7
-  m_edges.push_back(HEEdge(v3idx, e3idx, e1idx, f1idx));//e8
+  const Index E = (Index)m_edges.size();
+  const Index F = (Index)m_faces.size();
+  const Index V = (Index)m_verts.size();
 
-  //modify existing face/edge
-  m_faces[f0idx].edge = e0idx;
-  m_verts[v0idx].edge = e0idx;
-  m_verts[v1idx].edge = e1idx;
-  m_verts[v2idx].edge = e2idx;
+  //new_idx[e] : new index of edge e (-1 if removed)
+  //new_idx[E + v] : new index of vertex v (-1 if removed)
+  std::vector<Index> new_idx(E + V);
 
-  m_edges[e0idx].SetNextFace(e3idx, f0idx);
-  m_edges[e1idx].SetNextFace(e7idx, f1idx);
-  m_edges[e2idx].SetNextFace(e5idx, f2idx);
+#pragma omp parallel for
+  for (Index e = 0; e < E; ++e)
+  {
+    const Index f = m_edges[e].face;
+    new_idx[e] = (f >= 0 && f < F && !face_dead[f]) ? 1 : 0;
+  }
+  for (Index v = 0; v < V; ++v) new_idx[E + v] = vert_dead[v] ? 0 : 1;
 
- 
-  std::stack<int> Q;
-  Q.push(e0idx);
-  Q.push(e1idx);
-  Q.push(e2idx);
+  //exclusive prefix sum
+  Index ne = 0, nv = 0;
+  for (Index e = 0; e < E; ++e) new_idx[e]     = new_idx[e]     ? ne++ : -1;
+  for (Index v = 0; v < V; ++v) new_idx[E + v] = new_idx[E + v] ? nv++ : -1;
 
-  while (!Q.empty())
+  //vertices whose edge was removed take another remaining outgoing edge
+  for (Index e = 0; e < E; ++e)
   {
-    const int piv = Q.top();
-    Q.pop();
-    if (m_edges[piv].oppo == -1) continue;
-
-    const int e0idx = piv;
-    const int e1idx = m_edges[e0idx].next;
-    const int e2idx = m_edges[e1idx].next;
-    const int e3idx = m_edges[e0idx].oppo;
-    const int e4idx = m_edges[e3idx].next;
-    const int e5idx = m_edges[e4idx].next;
-    
-    const int v0idx = m_edges[e0idx].vert;
-    const int v1idx = m_edges[e1idx].vert;
-    const int v2idx = m_edges[e2idx].vert;
-    const int v3idx = m_edges[e5idx].vert;
-    
-    const int f0idx = m_edges[e0idx].face;
-    const int f1idx = m_edges[e3idx].face;
-
-    bool tf = Delaunay_bPointInCircumCircle(m_verts[v0idx], m_verts[v1idx], m_verts[v2idx], m_verts[v3idx]);
-    if ( !tf ) continue;
-
-    //flip!
-    m_edges[e0idx].SetVertNext(v2idx, e5idx);
-    m_edges[e1idx].next = e0idx;
-    m_edges[e2idx].SetNextFace(e4idx, f1idx);
-
-    m_edges[e3idx].SetVertNext(v3idx, e2idx);
-    m_edges[e4idx].next = e3idx;
-    m_edges[e5idx].SetNextFace(e1idx, f0idx);
-
-    m_faces[f0idx].edge = e0idx;
-    m_faces[f1idx].edge = e3idx;
-    
-    m_verts[v0idx].edge = e4idx;
-    m_verts[v1idx].edge = e1idx;
-    m_verts[v2idx].edge = e2idx;
-    m_verts[v3idx].edge = e5idx;
-    
-    Q.push(e4idx);
-    Q.push(e5idx);
+    if (new_idx[e] < 0) continue;
+    Vert& v = m_verts[m_edges[e].vert];
+    if (v.edge < 0 || new_idx[v.edge] < 0) v.edge = e;
   }
-}
 
+  //compact (new index <= old index)
+  for (Index e = 0; e < E; ++e)
+  {
+    const Index ei = new_idx[e];
+    if (ei < 0) continue;
+    const Edge& src = m_edges[e];
+    const Index oppo = (src.oppo < 0) ? -1 : new_idx[src.oppo];
+    m_edges[ei] = Edge(new_idx[E + src.vert], oppo, new_idx[src.next], -1, src.IsConstrained());
+  }
 
+  Index nf = 0;
+  for (Index f = 0; f < F; ++f)
+  {
+    const Index e = m_faces[f].edge;
+    if (e < 0 || new_idx[e] < 0) continue;
+    m_faces[nf++].edge = new_idx[e];
+  }
 
-bool DelaunayMesh::CheckAllEdge()
-{
-  bool result = true;
+  for (Index v = 0; v < V; ++v)
+  {
+    const Index vi = new_idx[E + v];
+    if (vi < 0) continue;
+    const Index e = m_verts[v].edge;
+    m_verts[vi] = Vert(m_verts[v].x, m_verts[v].y, (new_idx[e] < 0) ? -1 : new_idx[e]);
+  }
+
+  m_edges.resize(ne);
+  m_faces.resize(nf);
+  m_verts.erase(m_verts.begin() + nv, m_verts.end());
 
-  for (int ei = 0; ei < (int)m_edges.size(); ++ei)
+#pragma omp parallel for
+  for (Index f = 0; f < nf; ++f)
   {
-    if (m_edges[ei].oppo == -1) continue;
+    const Index e0 = m_faces[f].edge;
+    const Index e1 = m_edges[e0].next;
+    const Index e2 = m_edges[e1].next;
+    m_edges[e0].face = m_edges[e1].face = m_edges[e2].face = f;
+  }
+
+  m_walk_face = 0;
+  m_convex = false;
+  ClearFreeLists();
+  MarkAllDirty();
+}
+
 
-    const int e0idx = ei;
-    const int e1idx = m_edges[e0idx].next;
-    const int e2idx = m_edges[e1idx].next;
-    const int e3idx = m_edges[e0idx].oppo;
-    const int e4idx = m_edges[e3idx].next;
-    const int e5idx = m_edges[e4idx].next;
-    const int v0idx = m_edges[e0idx].vert;
-    const int v1idx = m_edges[e1idx].vert;
-    const int v2idx = m_edges[e2idx].vert;
-    const int v3idx = m_edges[e5idx].vert;
 
-    bool tf1 = Delaunay_bPointInCircumCircle(m_verts[v0idx], m_verts[v1idx], m_verts[v2idx], m_verts[v3idx]);
-    bool tf2 = Delaunay_bPointInCircumCircle(m_verts[v0idx], m_verts[v3idx], m_verts[v1idx], m_verts[v2idx]);
+//stochastic visibility walk
+//step to the neighbor across an edge that separates the face from p 
+//the first edge to test is chosen randomly so that the walk never cycles
+//returns
+//  face idx that contains p (onEdge = true if p is on its edge, 
+//  edge = that edge, or -1 if p is on its vertex)
+//  -1 : p is outside of the mesh (edge = the boundary edge that p sees)
+//  -2 : the walk did not terminate in max_step (or met an unused slot)
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::WalkToPoint(
+    const Vert& p, 
+    Index f, 
+    unsigned& seed, 
+    Index max_step, 
+    bool& onEdge,
+    Index& edge) const
+{
+  edge = -1;
+  for (Index step = 0; step < max_step; ++step)
+  {
+    //xorshift32
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    Index e = m_faces[f].edge;
+    if (e < 0) return -2;
+    for (Index k = (Index)(seed % 3); k > 0; --k) e = m_edges[e].next;
+
+    Index cross = -1, zeros = 0;
+    onEdge = false;
+    for (Index k = 0; k < 3; ++k, e = m_edges[e].next)
+    {
+      const Index e_next = m_edges[e].next;
+      if (e_next < 0) return -2;
+      const Vert& a = m_verts[m_edges[e].vert];
+      const Vert& b = m_verts[m_edges[e_next].vert];
+      double d = CrossProductZ(a, b, p);
+      if (d < 0) { cross = e; break; }
+      if (d == 0) 
+      {
+        onEdge = true;
+        edge = e;
+        ++zeros;
+      }
+    }
+
+    if (cross == -1) 
+    {
+      if (zeros > 1) edge = -1;
+      return f;
+    }
 
-    if ( tf1 || tf2 )
-    { 
-      std::cout << "error " << ei << "\n";
-      result = false;
+    //p is outside of the mesh 
+    edge = -1;
+    if (m_edges[cross].oppo == -1) 
+    {
+      edge = cross;
+      return -1;
     }
+    f = m_edges[m_edges[cross].oppo].face;
+    if (f < 0) return -2;
   }
+  return -2;
+}
+
 
-  return result;
 
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::SearchFaceCotainPoint(double x, double y, Index hint)
+{
+  bool onEdge;
+  Index edge;
+  const Index f = SearchFaceCotainPoint(x, y, hint, onEdge, edge);
+  return onEdge ? -1 : f;
 }
 
 
 
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::SearchFaceCotainPoint(
+    double x, double y, Index hint, bool& onEdge, Index& edge)
+{
+  onEdge = false;
+  edge = -1;
+  if (m_faces.empty()) return -1;
+
+  Vert p((Real)x, (Real)y, -1);
+  Index f = (0 <= hint && hint < (Index)m_faces.size()) ? hint : m_walk_face;
+  if (f < 0 || (Index)m_faces.size() <= f) f = (Index)m_faces.size() - 1;
+  if (m_faces[f].edge < 0) f = *Faces().begin();
+  if (f >= (Index)m_faces.size() || m_faces[f].edge < 0) return -1;
+
+  f = WalkToPoint(p, f, m_walk_seed, (Index)m_faces.size() + 1, onEdge, edge);
+
+  //the walk did not terminate (non-Delaunay mesh), or it left a non convex 
+  //mesh through a concave part of the boundary (p may be in another face)
+  //use brute force. edge stays the boundary edge where the walk left
+  if (f == -2 || (f == -1 && !m_convex)) 
+  {
+    const Index exit = edge;
+    f = SearchFaceCotainPointLinear(x, y, onEdge, edge);
+    if (f < 0) 
+    {
+      onEdge = false;
+      edge = exit;
+      return -1;
+    }
+  }
+  if (f < 0) return -1;
+
+  m_walk_face = f;
+  return f;
+}
+
+
 
-void DelaunayMesh::GetFaceVsEs(
-  int fidx,
-  int& e0, int& e1, int& e2,
-  int& v0, int& v1, int& v2) const
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::SearchFaceCotainPointLinear(double x, double y)
 {
-  e0 = m_faces[fidx].edge;
-  e1 = m_edges[e0].next;
-  e2 = m_edges[e1].next;
-  v0 = m_edges[e0].vert;
-  v1 = m_edges[e1].vert;
-  v2 = m_edges[e2].vert;
+  bool onEdge;
+  Index edge;
+  const Index f = SearchFaceCotainPointLinear(x, y, onEdge, edge);
+  return onEdge ? -1 : f;
 }
 
 
 
-void DelaunayMesh::InitByVsFs(
-  std::vector<std::array<double, 2>>& verts,
-  std::vector<std::array<int   , 3>>& faces)
+//test all live faces (O(F)). the result is the same as WalkToPoint, 
+//except that -1 (outside) does not give an edge
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::SearchFaceCotainPointLinear(
+    double x, double y, bool& onEdge, Index& edge) const
 {
-  std::vector<HEVert> new_vs;
-  std::vector<HEEdge> new_es;
-  std::vector<HEFace> new_fs;
+  const Vert p((Real)x, (Real)y, -1);
+  onEdge = false;
+  edge = -1;
 
-  for (int i = 0; i < (int)verts.size(); ++i )
-  { 
-    new_vs.push_back(HEVert(verts[i][0], verts[i][1], -1));
+  for (Index i = 0; i < (Index)m_faces.size(); ++i)
+  {
+    Index e = m_faces[i].edge;
+    if (e < 0) continue;
+
+    Index on = -1, zeros = 0;
+    bool inside = true;
+    for (Index k = 0; k < 3 && inside; ++k, e = m_edges[e].next)
+    {
+      const Vert& a = m_verts[m_edges[e].vert];
+      const Vert& b = m_verts[m_edges[m_edges[e].next].vert];
+      const double d = CrossProductZ(a, b, p);
+      if (d < 0) inside = false;
+      if (d == 0) 
+      {
+        on = e;
+        ++zeros;
+      }
+    }
+    if (!inside) continue;
+
+    onEdge = zeros > 0;
+    edge = (zeros > 1) ? -1 : on;
+    return i;
   }
 
-  //_ verts[i]˂edgeidێ  
-  std::vector<std::vector<int>> v_out_edge(new_vs.size());
+  return -1;
+}
 
-  for (int fi = 0; fi < (int)faces.size(); ++fi)
-  {
-    int v0 = faces[fi][0];
-    int v1 = faces[fi][1];
-    int v2 = faces[fi][2];
-    int e0 = (int)new_es.size();
-    int e1 = (int)new_es.size() + 1;
-    int e2 = (int)new_es.size() + 2;
 
-    //search opposite edges
-    int e0oppo = -1, e1oppo = -1, e2oppo = -1;
 
-    for (auto& e : v_out_edge[v1]) if (new_es[new_es[e].next].vert == v0) e0oppo = e;
-    for (auto& e : v_out_edge[v2]) if (new_es[new_es[e].next].vert == v1) e1oppo = e;
-    for (auto& e : v_out_edge[v0]) if (new_es[new_es[e].next].vert == v2) e2oppo = e;
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::AddNewVertex(double x, double y)
+{
+  const Index v = NewVert(x, y);
+  if (InsertVertex(v)) return true;
 
-    if (e0oppo != -1) new_es[e0oppo].oppo = e0;
-    if (e1oppo != -1) new_es[e1oppo].oppo = e1;
-    if (e2oppo != -1) new_es[e2oppo].oppo = e2;
-    new_es.push_back(HEEdge(v0, e0oppo, e1, fi));
-    new_es.push_back(HEEdge(v1, e1oppo, e2, fi));
-    new_es.push_back(HEEdge(v2, e2oppo, e0, fi));
-    new_fs.push_back(HEFace(e0));
+  FreeVert(v);
+  return false;
+}
 
-    v_out_edge[v0].push_back(e0);
-    v_out_edge[v1].push_back(e1);
-    v_out_edge[v2].push_back(e2);
-    new_vs[v0].edge = e0;
-    new_vs[v1].edge = e1;
-    new_vs[v2].edge = e2;
-  }
 
-  m_verts = new_vs;
-  m_edges = new_es;
-  m_faces = new_fs;
 
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::InsertPoints(const std::vector<std::array<double, 2>>& points, Index hint)
+{
+  std::vector<Index> vidx;
+  return InsertPoints(points, hint, vidx);
 }
 
 
 
-double DelaunayMesh::CalcAverateEdgeLength()
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::InsertPoints(
+  const std::vector<std::array<double, 2>>& points, 
+  Index hint,
+  std::vector<Index>& vidx)
 {
-  double sum = 0;
-  for (int i = 0; i < (int)m_edges.size(); ++i)
+  const Index N = (Index)points.size();
+  vidx.assign(N, -1);
+  if (N == 0 || m_faces.empty()) return 0;
+
+  double minx, miny, maxx, maxy;
+  std::vector<Index> order;
+  Delaunay_CalcBoundingBox(points, minx, miny, maxx, maxy);
+  Delaunay_CalcInsertOrder(points, minx, miny, maxx, maxy, InsertOrder::HILBERT, order);
+
+  if (0 <= hint && hint < (Index)m_faces.size() && m_faces[hint].edge >= 0) m_walk_face = hint;
+
+  //InsertVertex walks from m_walk_face and leaves it at the split face
+  Index num = 0;
+  for (const Index i : order)
   {
-      int v1 = m_edges[i].vert;
-      int v2 = m_edges[m_edges[i].next].vert;
-      sum += HEVert::Distance(m_verts[v1], m_verts[v2]);
+    const Index v = NewVert(points[i][0] - m_origin[0], points[i][1] - m_origin[1]);
+    if (InsertVertex(v))
+    {
+      vidx[i] = v;
+      ++num;
+    }
+    else
+    {
+      FreeVert(v);
+    }
   }
-  return sum / (double) m_edges.size();
+  return num;
 }
 
 
-void DelaunayMesh::RemoveBoundingFacesWithLongEdge(double r)
+
+//a point on an edge splits the edge, a point outside of a convex mesh is 
+//connected to the boundary edges it sees. duplicated points are rejected
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::InsertVertex(Index v3idx)
 {
-  //step1 mark faces to remove 
-  std::vector<bool> face_flg(m_faces.size(), false);
+  bool onEdge;
+  Index e0idx;
+  const Index f0idx = SearchFaceCotainPoint(
+    m_verts[v3idx].x, m_verts[v3idx].y, -1, onEdge, e0idx);
 
-  while (true)
+  if (f0idx < 0 && !(e0idx >= 0 && m_convex)) return false;
+  if (onEdge && e0idx < 0) return false;
+
+  const size_t capacity = m_faces.capacity() + m_edges.capacity() + 
+                          m_flip_stack.capacity();
+
+  if (f0idx < 0)
   {
-    bool updated = false;
-    for (int i = 0; i < m_faces.size(); ++i)
-    {
-      if (face_flg[i]) continue;
+    InsertVertexOutside(e0idx, v3idx, m_flip_stack);
+  }
+  else
+  {
+    //Add new face/edge (tombstone slots are reused first)
+    //splitting a boundary edge needs only one face and three edges
+    const Index n = (onEdge && m_edges[e0idx].oppo == -1) ? 1 : 2;
+    Index fs[2] = { -1, -1 }, es[6] = { -1, -1, -1, -1, -1, -1 };
+    for (Index i = 0; i < n    ; ++i) fs[i] = NewFace();
+    for (Index i = 0; i < 3 * n; ++i) es[i] = NewEdge();
+
+    if (onEdge) InsertVertexToEdge(e0idx, v3idx, fs, es, m_flip_stack);
+    else        InsertVertexToFace(f0idx, v3idx, fs, es, m_flip_stack);
+  }
 
-      int e0, e1, e2, v0, v1, v2;
-      GetFaceVsEs(i, e0, e1, e2, v0, v1, v2);
+  if (capacity != m_faces.capacity() + m_edges.capacity() + 
+                  m_flip_stack.capacity())
+    ++m_insert_alloc_count;
+  return true;
+}
 
-      bool isBoundary = 
-        (m_edges[e0].oppo == -1 || face_flg[m_edges[m_edges[e0].oppo].face]) ||
-        (m_edges[e1].oppo == -1 || face_flg[m_edges[m_edges[e1].oppo].face]) ||
-        (m_edges[e2].oppo == -1 || face_flg[m_edges[m_edges[e2].oppo].face]);
-      if (!isBoundary) continue;
 
-      double d0 = HEVert::Distance(m_verts[v0], m_verts[v1]);
-      double d1 = HEVert::Distance(m_verts[v1], m_verts[v2]);
-      double d2 = HEVert::Distance(m_verts[v2], m_verts[v0]);
-      if (d0 <= r && d1 <= r && d2 <= r) continue;
 
-      //remove this face
-      face_flg[i] = true;
-      updated = true;
-    }
-    if (!updated)break;
-  }
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::InsertVertexToFace(
+  Index f0idx, Index v3idx, const Index fs[2], const Index es[6], 
+  std::vector<Index>& flip_stack)
+{
+  //existing triangle  
+  const Index e0idx = m_faces[f0idx].edge;
+  const Index e1idx = m_edges[e0idx].next;
+  const Index e2idx = m_edges[e1idx].next;
+  const Index v0idx = m_edges[e0idx].vert;
+  const Index v1idx = m_edges[e1idx].vert;
+  const Index v2idx = m_edges[e2idx].vert;
+
+  //new face/edge 
+  const Index f1idx = fs[0], f2idx = fs[1];
+  const Index e3idx = es[0], e4idx = es[1], e5idx = es[2], e6idx = es[3];
+  const Index e7idx = es[4], e8idx = es[5];
+
+  m_verts[v3idx].edge = e4idx;
+  m_faces[f1idx] = Face(e8idx);
+  m_faces[f2idx] = Face(e6idx);
+
+  m_edges[e3idx] = Edge(v1idx, e8idx, e4idx, f0idx);
+  m_edges[e4idx] = Edge(v3idx, e5idx, e0idx, f0idx);
+  m_edges[e5idx] = Edge(v0idx, e4idx, e6idx, f2idx);
+  m_edges[e6idx] = Edge(v3idx, e7idx, e2idx, f2idx);
+  m_edges[e7idx] = Edge(v2idx, e6idx, e8idx, f1idx);
+  m_edges[e8idx] = Edge(v3idx, e3idx, e1idx, f1idx);
 
-  //step2 mark verts to remove
-  std::vector<bool> vert_flg(m_verts.size(), true);
-  for (int i = 0; i < m_faces.size(); ++i)
+  //modify existing face/edge
+  m_faces[f0idx].edge = e0idx;
+  if (!m_defer_vert_edges)
   {
-    if (face_flg[i]) continue;
-    int e0, e1, e2, v0, v1, v2;
-    GetFaceVsEs(i, e0, e1, e2, v0, v1, v2);
-    vert_flg[v0] = vert_flg[v1] = vert_flg[v2] = false;
+    m_verts[v0idx].edge = e0idx;
+    m_verts[v1idx].edge = e1idx;
+    m_verts[v2idx].edge = e2idx;
   }
 
-  //step3 listup all triangles and vertex
-  std::vector<std::array<double, 2>> new_vs;
-  std::vector<std::array<int, 3>>    new_fs;
+  m_edges[e0idx].SetNextFace(e3idx, f0idx);
+  m_edges[e1idx].SetNextFace(e7idx, f1idx);
+  m_edges[e2idx].SetNextFace(e5idx, f2idx);
+
+  MarkDirty(e4idx);
+  MarkDirty(e6idx);
+  MarkDirty(e8idx);
+ 
+  std::vector<Index>& Q = flip_stack;
+  Q.clear();
+  Q.push_back(e0idx);
+  Q.push_back(e1idx);
+  Q.push_back(e2idx);
+  FlipLinkEdges(Q);
+}
 
-  //new idx of new_vs
-  std::vector<int> new_vidx(m_verts.size(), -1);
 
-  for (int i = 0; i < m_verts.size(); ++i)
+
+//split edge e0idx (and its twin face) by vert[v4idx] on it 
+/*
+        c                  c
+       / \                /|\
+   e2 /f0 \ e1        e2 / | \ e1
+     / e0  \            /f0|fA\
+    a ----> b    =>    a-->m-->b 
+     \ e3  /            \fB|f1/
+   e4 \f1 / e5        e4 \ | / e5
+       \ /                \|/
+        d                  d
+*/
+//new faces fs[0] (fA), fs[1] (fB) and edges es[0] ... es[5] should be 
+//allocated. for a boundary edge (no twin), only fs[0] and es[0..2] are used
+//the two halves of a constrained edge stay constrained
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::InsertVertexToEdge(
+  Index e0idx, Index v4idx, const Index fs[2], const Index es[6], 
+  std::vector<Index>& flip_stack)
+{
+  const Index e1idx = m_edges[e0idx].next;
+  const Index e2idx = m_edges[e1idx].next;
+  const Index e3idx = m_edges[e0idx].oppo;
+  const Index cidx  = m_edges[e2idx].vert;
+  const Index f0idx = m_edges[e0idx].face;
+  const bool cons = m_edges[e0idx].IsConstrained();
+
+  //m->c, c->m, m->b
+  const Index fA = fs[0];
+  const Index x0 = es[0], x1 = es[1], y0 = es[2];
+
+  m_edges[e0idx].next = x0;
+  m_edges[x0] = Edge(v4idx, x1, e2idx, f0idx);
+  m_edges[y0] = Edge(v4idx, e3idx, e1idx, fA, cons);
+  m_edges[x1] = Edge(cidx , x0, y0, fA);
+  m_edges[e1idx].SetNextFace(x1, fA);
+  m_faces[fA]    = Face(y0);
+  m_faces[f0idx] = Face(e0idx);
+
+  m_verts[v4idx].edge = y0;
+  MarkDirty(e0idx);
+  MarkDirty(x0);
+  MarkDirty(y0);
+
+  std::vector<Index>& Q = flip_stack;
+  Q.clear();
+  Q.push_back(e1idx);
+  Q.push_back(e2idx);
+
+  if (e3idx != -1)
   {
-    if (vert_flg[i]) continue;
-    new_vidx[i] = (int)new_vs.size();
-    new_vs.push_back({m_verts[i].x, m_verts[i].y});
+    const Index e4idx = m_edges[e3idx].next;
+    const Index e5idx = m_edges[e4idx].next;
+    const Index didx  = m_edges[e5idx].vert;
+    const Index f1idx = m_edges[e3idx].face;
+
+    //m->d, d->m, m->a
+    const Index fB = fs[1];
+    const Index z0 = es[3], z1 = es[4], w0 = es[5];
+
+    m_edges[e3idx].next = z0;
+    m_edges[e0idx].oppo = w0;
+    m_edges[z0] = Edge(v4idx, z1, e5idx, f1idx);
+    m_edges[w0] = Edge(v4idx, e0idx, e4idx, fB, cons);
+    m_edges[z1] = Edge(didx , z0, w0, fB);
+    m_edges[e4idx].SetNextFace(z1, fB);
+    m_edges[e3idx].oppo = y0;
+    m_faces[fB]    = Face(w0);
+    m_faces[f1idx] = Face(e3idx);
+    MarkDirty(z0);
+
+    Q.push_back(e4idx);
+    Q.push_back(e5idx);
   }
-    
-  for (int i = 0; i < m_faces.size(); ++i)
+  FlipLinkEdges(Q);
+}
+
+
+
+/*-----------------------------
+* insertion outside of the mesh (ghost triangles)
+*
+* the outside of a convex mesh is covered by ghost triangles, one per 
+* boundary edge (a, b) and the vertex at infinity. they are not stored : 
+* a boundary edge (oppo = -1) stands for its ghost triangle, and p is in 
+* the "circumcircle" of the ghost triangle iff p sees the edge 
+* (strictly on its right). p replaces the vertex at infinity of those 
+* ghost triangles, and the link edges are flipped as usual 
+*
+*      p                     p
+*    .   .                 / | \
+*   a --- b --- c   =>   a - b - c 
+*   (visible edges)      
+-----------------------------*/
+
+//e : boundary edge visible from vert[vidx] (found by WalkToPoint)
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::InsertVertexOutside(Index e, Index vidx, std::vector<Index>& flip_stack)
+{
+  const Vert p = m_verts[vidx];
+  auto Visible = [&](Index b) {
+    const Vert& u = m_verts[m_edges[b].vert];
+    const Vert& w = m_verts[m_edges[m_edges[b].next].vert];
+    return CrossProductZ(u, w, p) < 0;
+  };
+
+  //boundary edges before / after b along the boundary
+  auto PrevBoundary = [&](Index b) {
+    Index in = m_edges[m_edges[b].next].next;
+    while (m_edges[in].oppo != -1) in = m_edges[m_edges[m_edges[in].oppo].next].next;
+    return in;
+  };
+  auto NextBoundary = [&](Index b) {
+    Index out = m_edges[b].next;
+    while (m_edges[out].oppo != -1) out = m_edges[m_edges[out].oppo].next;
+    return out;
+  };
+
+  //visible edges are consecutive on a convex boundary
+  std::vector<Index>& chain = m_hull_chain;
+  chain.clear();
+  Index first = e;
+  for (Index b = PrevBoundary(e); b != e && Visible(b); b = PrevBoundary(b)) first = b;
+  Index b = first;
+  do
+  {
+    chain.push_back(b);
+    b = NextBoundary(b);
+  } 
+  while (b != first && Visible(b));
+
+  //new face per visible edge u0->u1 : (u1, u0, p)
+  std::vector<Index>& Q = flip_stack;
+  Q.clear();
+  Index prev = -1;
+  for (const Index c : chain)
   {
-    if (face_flg[i]) continue;
-    int e0, e1, e2, v0, v1, v2;
-    GetFaceVsEs(i, e0, e1, e2, v0, v1, v2);
-    new_fs.push_back({ new_vidx[v0], new_vidx[v1], new_vidx[v2]});
+    const Index u0 = m_edges[c].vert;
+    const Index u1 = m_edges[m_edges[c].next].vert;
+    const Index f  = NewFace();
+    const Index t  = NewEdge();
+    const Index s  = NewEdge();
+    const Index r  = NewEdge();
+
+    m_edges[t] = Edge(u1  , c   , s, f, m_edges[c].IsConstrained());
+    m_edges[s] = Edge(u0  , prev, r, f);
+    m_edges[r] = Edge(vidx, -1  , t, f);
+    m_edges[c].oppo = t;
+    if (prev != -1) m_edges[prev].oppo = s;
+    m_faces[f] = Face(t);
+
+    MarkDirty(s);
+    MarkDirty(r);
+    m_verts[vidx].edge = r;
+    m_walk_face = f;
+    prev = r;
+    Q.push_back(t);
   }
-
-  this->InitByVsFs(new_vs, new_fs);
+  FlipLinkEdges(Q);
 }
 
 
 
+//flip the link edges of a new vert (and the far side edges of each flip)
+//until they are (constrained) Delaunay
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::FlipLinkEdges(std::vector<Index>& Q)
+{
+  while (!Q.empty())
+  {
+    const Index piv = Q.back();
+    Q.pop_back();
+    MarkDirty(piv);
+    if (!FlipIfNotDelaunay(piv)) continue;
+
+    //edges of the far side (e4, e5 below) 
+    Q.push_back(m_edges[m_edges[m_edges[piv].oppo].next].next);
+    Q.push_back(m_edges[piv].next);
+  }
+}
 
 
 
-std::vector<int> getOutgoingEdges(
-    int vertex, 
-    const std::vector<HEEdge>& edges, 
-    const std::vector<int   >& vertToEdge) 
+//flip edge e0idx if the opposite vertex is in the circumcircle of its face
+//after the flip, the far side edges are e[e0].next and e[e[e[e0].oppo].next].next
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::FlipIfNotDelaunay(const Index e0idx)
 {
+  if (m_edges[e0idx].oppo == -1 || m_edges[e0idx].IsConstrained()) return false;
 
-  std::vector<int> outgoingEdges;
-  int startEdge = vertToEdge[vertex];
-  int edge = startEdge;
+  const Index e1idx = m_edges[e0idx].next;
+  const Index e2idx = m_edges[e1idx].next;
+  const Index e5idx = m_edges[m_edges[m_edges[e0idx].oppo].next].next;
 
-  do {
-    outgoingEdges.push_back(edge);
-    edge = edges[edges[edge].oppo].next;
-  } while (edge != startEdge);
+  bool tf = Delaunay_bPointInCircumCircle(
+    m_verts[m_edges[e0idx].vert], m_verts[m_edges[e1idx].vert], 
+    m_verts[m_edges[e2idx].vert], m_verts[m_edges[e5idx].vert]);
+  if ( !tf ) return false;
 
-  return outgoingEdges;
+  FlipEdge(e0idx);
+  return true;
 }
 
 
-//if vidx is on boundary, this function returns false 
-//otherwise this returns true and set vs/es
-bool DelaunayMesh::GetOneRing(
-    const int vidx, 
-    std::vector<int>& vs, 
-    std::vector<int>& es)
-{
-  if (vidx < 0 && m_verts.size() <= vidx) return false;
-  if (m_verts[vidx].edge < 0 ) return false;
 
+//flip edge e0idx (both faces should form a convex quad)
+/*
+       v2                  v2
+      /  \                / |\
+    e2 f0 e1            e2  | e1
+    /  e0  \            / f1|f0\
+  v0 ------ v1   ->   v0  e3|e0 v1
+    \  e3  /            \   |  /
+    e4 f1 e5            e4  | e5
+      \  /                \ |/
+       v3                  v3
+*/
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::FlipEdge(const Index e0idx)
+{
+  const Index e1idx = m_edges[e0idx].next;
+  const Index e2idx = m_edges[e1idx].next;
+  const Index e3idx = m_edges[e0idx].oppo;
+  const Index e4idx = m_edges[e3idx].next;
+  const Index e5idx = m_edges[e4idx].next;
   
-  const int piv_edge = m_verts[vidx].edge;
+  const Index v0idx = m_edges[e0idx].vert;
+  const Index v1idx = m_edges[e1idx].vert;
+  const Index v2idx = m_edges[e2idx].vert;
+  const Index v3idx = m_edges[e5idx].vert;
   
-  vs.clear();
-  es.clear();
+  const Index f0idx = m_edges[e0idx].face;
+  const Index f1idx = m_edges[e3idx].face;
 
-  int e = piv_edge;
-  //std::cout << "----------------------  " << vidx << " " << e << "\n";
-  while(true)
-  {
-    //Check : vidx is on boundary
-    if (m_edges[e].oppo == -1)
-    {
-      es.clear();
-      return false;
-    }
-    
-    es.push_back(e);
-    e = m_edges[m_edges[e].oppo].next;
+  //flip!
+  m_edges[e0idx].SetVertNext(v2idx, e5idx);
+  m_edges[e1idx].next = e0idx;
+  m_edges[e2idx].SetNextFace(e4idx, f1idx);
 
-    if (e == piv_edge) break;
-  }
+  m_edges[e3idx].SetVertNext(v3idx, e2idx);
+  m_edges[e4idx].next = e3idx;
+  m_edges[e5idx].SetNextFace(e1idx, f0idx);
 
-  for(const auto &it : es) 
-  {
-    vs.push_back( m_edges[m_edges[it].next].vert );
-  }
+  m_faces[f0idx].edge = e0idx;
+  m_faces[f1idx].edge = e3idx;
 
-  return true;
+  MarkDirty(e0idx);
+  MarkDirty(e1idx);
+  MarkDirty(e2idx);
+  MarkDirty(e4idx);
+  MarkDirty(e5idx);
+  
+  if (m_defer_vert_edges) return;
+  m_verts[v0idx].edge = e4idx;
+  m_verts[v1idx].edge = e1idx;
+  m_verts[v2idx].edge = e2idx;
+  m_verts[v3idx].edge = e5idx;
 }
 
 
 
-void DelaunayMesh::MoveVertsToVolonoiCenter()
+/*-----------------------------
+* parallel incremental insertion 
+* 
+* vertex verts[k] uses preallocated slots 
+*   faces : nf + 2k, nf + 2k + 1
+*   edges : ne + 6k ... ne + 6k + 5
+* 
+* a thread locks the face containing the point and every face that the 
+* edge flips of InsertVertexToFace will read or modify (the faces whose 
+* circumcircle test succeeds and their neighbors). 
+* the same circumcircle test as the flip loop decides the locked region.
+* if one of the locks is taken by other thread, all locks are released and
+* the point is retried later. 
+* points on an edge or outside of the mesh are inserted by InsertVertex 
+* in one thread at the end of each block (their slots are freed first)
+*
+* memory model : there is no unlocked access to shared data. the walk 
+* holds the lock of the current face and locks the next one before it is 
+* released (hand over hand). the twin t of an edge of a locked face f is 
+* only changed by a thread that holds f, because an insertion locks the 
+* neighbors of its faces too. so each half edge / face is read and written 
+* under its face lock, and the lock (acquire) / unlock (release) pairs order 
+* the accesses of different threads. the edge of a vert is shared by the 
+* threads around it, so it is not set in the block (m_defer_vert_edges) 
+* but by a serial pass after it (the omp barrier orders it). verts are 
+* read only (all coordinates are set before the block)
+-----------------------------*/
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::InsertVertsParallel(const std::vector<Index>& verts)
 {
-  std::vector<HEVert> new_verts = m_verts;
-  
-  for (int i = 0; i < (int)m_verts.size(); ++i)
+  const Index N  = (Index)verts.size();
+  const Index nf = (Index)m_faces.size();
+  const Index ne = (Index)m_edges.size();
+
+  m_faces.resize(nf + 2 * N);
+  m_edges.resize(ne + 6 * N);
+
+  //threads do not record dirty edges
+  MarkAllDirty();
+
+  std::vector<std::atomic<int>> face_lock;
+
+  auto SlotsOf = [nf, ne](Index k, Index fs[2], Index es[6]) {
+    fs[0] = nf + 2 * k;
+    fs[1] = nf + 2 * k + 1;
+    for (Index i = 0; i < 6; ++i) es[i] = ne + 6 * k + i;
+  };
+
+  //1:inserted, 0:not inserted (on an edge / outside / duplicated), -1:conflict
+  auto TryInsert = [&](Index k, Index& walk_face, unsigned& seed, 
+                       std::vector<Index>& locked, std::vector<Index>& cavity) -> int
+  {
+    const Index vidx = verts[k];
+    const Vert& p = m_verts[vidx];
+
+    auto Release = [&]() {
+      for (const auto& f : locked) face_lock[f].store(0, std::memory_order_release);
+      locked.clear();
+    };
+    auto Lock = [&](Index f) -> bool {
+      int expect = 0;
+      if (!face_lock[f].compare_exchange_strong(expect, 1, std::memory_order_acquire)) return false;
+      locked.push_back(f);
+      return true;
+    };
+
+    //visibility walk (as WalkToPoint) holding the lock of the current face
+    //the face containing p stays locked
+    Index f0 = walk_face;
+    if (!Lock(f0)) return -1;
+    for (Index step = 0; ; ++step)
+    {
+      if (step == (Index)m_faces.size() || m_faces[f0].edge < 0)
+      {
+        Release();
+        return -1;
+      }
+
+      //xorshift32
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+
+      Index e = m_faces[f0].edge;
+      for (Index i = (Index)(seed % 3); i > 0; --i) e = m_edges[e].next;
+
+      Index cross = -1;
+      bool  zero  = false;
+      for (Index i = 0; i < 3; ++i, e = m_edges[e].next)
+      {
+        const double d = CrossProductZ(m_verts[m_edges[e].vert], m_verts[m_edges[m_edges[e].next].vert], p);
+        if (d < 0) 
+        { 
+          cross = e; 
+          break; 
+        }
+        if (d == 0) zero = true;
+      }
+
+      //on an edge, or outside of the mesh
+      const Index t = (cross == -1) ? -1 : (Index)m_edges[cross].oppo;
+      if ((cross == -1 && zero) || (cross != -1 && t == -1))
+      {
+        Release();
+        walk_face = f0;
+        return 0;
+      }
+      if (cross == -1) break;
+
+      //hand over hand
+      const Index g = m_edges[t].face;
+      if (!Lock(g))
+      {
+        Release();
+        return -1;
+      }
+      face_lock[f0].store(0, std::memory_order_release);
+      locked.erase(locked.begin());
+      f0 = g;
+    }
+
+    //lock faces touched by the flips
+    cavity.clear();
+    cavity.push_back(f0);
+    for (Index ci = 0; ci < (Index)cavity.size(); ++ci)
+    {
+      const Index e_first = m_faces[cavity[ci]].edge;
+      Index e = e_first;
+      do 
+      {
+        const Index t = m_edges[e].oppo;
+        if (t != -1)
+        {
+          const Index g = m_edges[t].face;
+          const bool isLocked = std::find(locked.begin(), locked.end(), g) != locked.end();
+          if (!isLocked && !Lock(g))
+          {
+            Release();
+            return -1;
+          }
+          const Index a = m_edges[e].vert;
+          const Index b = m_edges[m_edges[e].next].vert;
+          const Index w = m_edges[m_edges[m_edges[t].next].next].vert;
+          if (std::find(cavity.begin(), cavity.end(), g) == cavity.end() &&
+              Delaunay_bPointInCircumCircle(m_verts[a], m_verts[b], p, m_verts[w]))
+            cavity.push_back(g);
+        }
+        e = m_edges[e].next;
+      } 
+      while (e != e_first);
+    }
+
+    //new faces are not reachable from others yet
+    Lock(nf + 2 * k);
+    Lock(nf + 2 * k + 1);
+
+    Index fs[2], es[6];
+    SlotsOf(k, fs, es);
+    InsertVertexToFace(f0, vidx, fs, es, cavity);
+    Release();
+    walk_face = f0;
+    return 1;
+  };
+
+  //the first points are inserted by one thread, then blocks of doubling 
+  //size are inserted in parallel so that the mesh is coarse enough
+  for (Index begin = 0, end = std::min(N, (Index)1024); begin < N; 
+       begin = end, end = std::min(N, 2 * end))
   {
-    std::vector<int> vs, es;
-    if (GetOneRing(i, vs, es))
+    std::vector<Index> deferred;
+
+    //faces added by InsertVertex (outside points) need locks too
+    if (face_lock.size() != m_faces.size())
+    {
+      std::vector<std::atomic<int>> tmp(m_faces.size());
+      for (auto& l : tmp) l.store(0);
+      face_lock.swap(tmp);
+    }
+
+    m_defer_vert_edges = true;
+#pragma omp parallel if(begin > 0)
     {
-      double x = 0, y = 0;
-      for (const auto &v : vs) 
+      Index walk_face = 0;
+      unsigned seed = 1;
+#ifdef _OPENMP
+      seed += (unsigned)omp_get_thread_num();
+#endif
+      std::vector<Index> locked, cavity, my_deferred;
+
+#pragma omp for schedule(dynamic, 64)
+      for (Index k = begin; k < end; ++k)
       {
-        x += m_verts[v].x;
-        y += m_verts[v].y;
+        Index res = -1;
+        for (Index trial = 0; trial < 8 && res == -1; ++trial)
+          res = TryInsert(k, walk_face, seed, locked, cavity);
+
+        if (res != 1) my_deferred.push_back(k);
       }
-      new_verts[i].x = x / vs.size();
-      new_verts[i].y = y / vs.size();
+
+#pragma omp critical
+      deferred.insert(deferred.end(), my_deferred.begin(), my_deferred.end());
+    }
+    m_defer_vert_edges = false;
+
+    //edges of the verts (the unused slots of the block are dead)
+    for (Index e = 0; e < (Index)m_edges.size(); ++e)
+      if (m_edges[e].face >= 0) m_verts[m_edges[e].vert].edge = e;
+
+    //no conflict in single thread
+    Index walk_face = 0;
+    unsigned seed = 1;
+    std::vector<Index> locked, cavity;
+    for (const auto& k : deferred)
+    {
+      if (TryInsert(k, walk_face, seed, locked, cavity) == 1) continue;
+
+      //InsertVertex takes back the slots (and uses brute force if the walk 
+      //did not terminate)
+      Index fs[2], es[6];
+      SlotsOf(k, fs, es);
+      for (const Index f : fs) FreeFace(f);
+      for (const Index e : es) FreeEdge(e);
+      InsertVertex(verts[k]);
     }
   }
-  m_verts = new_verts;
-}
\ No newline at end of file
+}
+
+
+
+/*-----------------------------
+* Guibas-Stolfi divide and conquer
+* 
+* works on a temporary quad-edge structure (edge e = 4*q + r, r = rotation)
+* and converts the result into HEVert/HEEdge/HEFace by InitByVsFs
+* quad edges are stored with the index type of the mesh, there are twice 
+* as many of them as half edges (uint32_t : up to 2^31 half edges)
+-----------------------------*/
+
+template <class V, class IndexType>
+class QuadEdgeDC
+{
+public:
+  const std::vector<V>& m_ps;
+  std::vector<IndexT<IndexType>> m_onext;
+  std::vector<IndexT<IndexType>> m_org;
+  std::vector<bool> m_alive; // per quad edge
+
+  QuadEdgeDC(const std::vector<V>& ps) : m_ps(ps) 
+  {
+    m_onext.reserve(4 * 3 * ps.size());
+    m_org  .reserve(4 * 3 * ps.size());
+    m_alive.reserve(3 * ps.size());
+  }
+
+  static Index Rot   (Index e) { return (e & ~3) | ((e + 1) & 3); }
+  static Index Sym   (Index e) { return (e & ~3) | ((e + 2) & 3); }
+  static Index InvRot(Index e) { return (e & ~3) | ((e + 3) & 3); }
+
+  Index Onext(Index e) const { return m_onext[e]; }
+  Index Oprev(Index e) const { return Rot(m_onext[Rot(e)]); }
+  Index Lnext(Index e) const { return Rot(m_onext[InvRot(e)]); }
+  Index Rprev(Index e) const { return m_onext[Sym(e)]; }
+  Index Org  (Index e) const { return m_org[e]; }
+  Index Dest (Index e) const { return m_org[Sym(e)]; }
+
+  Index MakeEdge(Index org, Index dest)
+  {
+    const Index e = (Index)m_onext.size();
+    m_onext.insert(m_onext.end(), { e, e + 3, e + 2, e + 1 });
+    m_org  .insert(m_org  .end(), { org, -1, dest, -1 });
+    m_alive.push_back(true);
+    return e;
+  }
+
+  void Splice(Index a, Index b)
+  {
+    const Index alpha = Rot(m_onext[a]);
+    const Index beta  = Rot(m_onext[b]);
+    std::swap(m_onext[a], m_onext[b]);
+    std::swap(m_onext[alpha], m_onext[beta]);
+  }
+
+  Index Connect(Index a, Index b)
+  {
+    const Index e = MakeEdge(Dest(a), Org(b));
+    Splice(e, Lnext(a));
+    Splice(Sym(e), b);
+    return e;
+  }
+
+  void DeleteEdge(Index e)
+  {
+    Splice(e, Oprev(e));
+    Splice(Sym(e), Oprev(Sym(e)));
+    m_alive[e / 4] = false;
+  }
+
+  bool Ccw(Index a, Index b, Index c) const 
+  { 
+    return CrossProductZ(m_ps[a], m_ps[b], m_ps[c]) > 0; 
+  }
+  //true if d is strictly inside the circle through ccw triangle (a,b,c) 
+  bool InCircle(Index a, Index b, Index c, Index d) const
+  {
+    return Delaunay_bPointInCircumCircle(m_ps[a], m_ps[b], m_ps[c], m_ps[d]);
+  }
+  bool RightOf(Index v, Index e) const { return Ccw(v, Dest(e), Org(e)); }
+  bool LeftOf (Index v, Index e) const { return Ccw(v, Org(e), Dest(e)); }
+
+  //triangulate m_ps[begin, end) sorted by (x,y)
+  //ldo : ccw convex hull edge out of the leftmost vertex
+  //rdo : cw  convex hull edge out of the rightmost vertex
+  void Triangulate(Index begin, Index end, Index& ldo, Index& rdo)
+  {
+    const Index n = end - begin;
+    if (n == 2)
+    {
+      ldo = MakeEdge(begin, begin + 1);
+      rdo = Sym(ldo);
+      return;
+    }
+    if (n == 3)
+    {
+      const Index s0 = begin, s1 = begin + 1, s2 = begin + 2;
+      const Index a = MakeEdge(s0, s1);
+      const Index b = MakeEdge(s1, s2);
+      Splice(Sym(a), b);
+
+      if (Ccw(s0, s1, s2))
+      {
+        Connect(b, a);
+        ldo = a; 
+        rdo = Sym(b);
+      }
+      else if (Ccw(s0, s2, s1))
+      {
+        const Index c = Connect(b, a);
+        ldo = Sym(c);
+        rdo = c;
+      }
+      else
+      {
+        ldo = a;
+        rdo = Sym(b);
+      }
+      return;
+    }
+
+    const Index mid = begin + n / 2;
+    Index ldi, rdi;
+    Triangulate(begin, mid, ldo, ldi);
+    Triangulate(mid  , end, rdi, rdo);
+
+    //lower common tangent
+    while (true)
+    {
+      if      (LeftOf (Org(rdi), ldi)) ldi = Lnext(ldi);
+      else if (RightOf(Org(ldi), rdi)) rdi = Rprev(rdi);
+      else break;
+    }
+
+    Index basel = Connect(Sym(rdi), ldi);
+    if (Org(ldi) == Org(ldo)) ldo = Sym(basel);
+    if (Org(rdi) == Org(rdo)) rdo = basel;
+
+    //merge (zip up from the lower tangent)
+    while (true)
+    {
+      Index lcand = Onext(Sym(basel));
+      if (RightOf(Dest(lcand), basel))
+      {
+        while (InCircle(Dest(basel), Org(basel), Dest(lcand), Dest(Onext(lcand))))
+        {
+          const Index t = Onext(lcand);
+          DeleteEdge(lcand);
+          lcand = t;
+        }
+      }
+
+      Index rcand = Oprev(basel);
+      if (RightOf(Dest(rcand), basel))
+      {
+        while (InCircle(Dest(basel), Org(basel), Dest(rcand), Dest(Oprev(rcand))))
+        {
+          const Index t = Oprev(rcand);
+          DeleteEdge(rcand);
+          rcand = t;
+        }
+      }
+
+      const bool lvalid = RightOf(Dest(lcand), basel);
+      const bool rvalid = RightOf(Dest(rcand), basel);
+      if (!lvalid && !rvalid) break;
+
+      if (!lvalid || (rvalid && InCircle(Dest(lcand), Org(lcand), Org(rcand), Dest(rcand))))
+        basel = Connect(rcand, Sym(basel));
+      else
+        basel = Connect(Sym(basel), Sym(lcand));
+    }
+  }
+};
+
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::InitMeshDivideAndConquer(
+  const std::vector<Vert>& points)
+{
+  auto Same = [&points](Index a, Index b) { 
+    return points[a].x == points[b].x && points[a].y == points[b].y;
+  };
+
+  //sort by (x,y) and remove duplicated points
+  std::vector<Index> idx(points.size());
+  for (Index i = 0; i < (Index)idx.size(); ++i) idx[i] = i;
+  std::sort(idx.begin(), idx.end(), [&points](Index a, Index b) { 
+    const Vert& p = points[a];
+    const Vert& q = points[b];
+    return p.x < q.x || (p.x == q.x && (p.y < q.y || (p.y == q.y && a < b))); 
+  });
+  idx.erase(std::unique(idx.begin(), idx.end(), Same), idx.end());
+
+  //vertices are numbered in the order of the input points
+  std::vector<Index> new_vidx(points.size(), -1);
+  for (const auto& i : idx) new_vidx[i] = 0;
+
+  std::vector<Vert> verts;
+  for (Index i = 0; i < (Index)points.size(); ++i)
+  {
+    if (new_vidx[i] < 0) continue;
+    new_vidx[i] = (Index)verts.size();
+    verts.push_back(points[i]);
+  }
+
+  std::vector<std::array<Index, 3>> faces;
+  if (idx.size() >= 3)
+  {
+    std::vector<Vert> sorted;
+    sorted.reserve(idx.size());
+    for (const auto& i : idx) sorted.push_back(points[i]);
+
+    QuadEdgeDC<Vert, IndexType> qe(sorted);
+    Index ldo, rdo;
+    qe.Triangulate(0, (Index)sorted.size(), ldo, rdo);
+
+    //each ccw triangle is listed once from its smallest primal edge
+    for (Index e = 0; e < (Index)qe.m_onext.size(); e += 2)
+    {
+      if (!qe.m_alive[e / 4]) continue;
+      const Index e1 = qe.Lnext(e);
+      const Index e2 = qe.Lnext(e1);
+      if (qe.Lnext(e2) != e || e1 < e || e2 < e) continue;
+
+      const Index v0 = qe.Org(e), v1 = qe.Org(e1), v2 = qe.Org(e2);
+      if (!qe.Ccw(v0, v1, v2)) continue;
+      faces.push_back({ new_vidx[idx[v0]], new_vidx[idx[v1]], new_vidx[idx[v2]] });
+    }
+  }
+
+  InitByVsFsLocal(verts, faces);
+  m_convex = true;
+}
+
+
+
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::CheckAllEdge()
+{
+  return Validate().num_non_delaunay == 0;
+}
+
+
+
+/*-----------------------------
+* validation
+*
+* Validate checks all half edges in parallel. ValidateDirty checks the 
+* recorded edges expanded to the edges of their faces and twin faces, so 
+* that the face (by its first edge) and incircle (by the smaller twin) 
+* tests see the same edges as Validate. 
+-----------------------------*/
+
+static const int VALID_TOPOLOGY     = 1;
+static const int VALID_INVERTED     = 2;
+static const int VALID_NON_DELAUNAY = 4;
+
+
+
+template <class Real, class IndexType>
+int DelaunayMeshT<Real, IndexType>::ValidateEdge(Index h) const
+{
+  const Index E = (Index)m_edges.size();
+  const Index F = (Index)m_faces.size();
+  const Index V = (Index)m_verts.size();
+  auto LiveEdge = [&](Index e) { return 0 <= e && e < E && m_edges[e].face >= 0; };
+  auto VertOk   = [&](Index v) { return 0 <= v && v < V && m_verts[v].edge >= 0; };
+
+  const Edge& e = m_edges[h];
+  const Index n  = e.next;
+  const Index nn = LiveEdge(n) ? (Index)m_edges[n].next : -1;
+  if (!LiveEdge(nn) || m_edges[nn].next != h || e.face >= F ||
+      m_edges[n].face != e.face || m_edges[nn].face != e.face || 
+      !VertOk(e.vert) || !VertOk(m_edges[n].vert) || !VertOk(m_edges[nn].vert))
+    return VALID_TOPOLOGY;
+
+  const Index o = e.oppo;
+  if (o != -1 && (!LiveEdge(o) || m_edges[o].oppo != h || 
+                  m_edges[o].vert != m_edges[n].vert || 
+                  m_edges[o].IsConstrained() != e.IsConstrained()))
+    return VALID_TOPOLOGY;
+
+  int err = 0;
+  const Vert& a = m_verts[e.vert];
+  const Vert& b = m_verts[m_edges[n].vert];
+  const Vert& c = m_verts[m_edges[nn].vert];
+  if (m_faces[e.face].edge == h && CrossProductZ(a, b, c) <= 0) err |= VALID_INVERTED;
+
+  if (o > h && !e.IsConstrained())
+  {
+    const Index on = m_edges[o].next;
+    const Index w  = LiveEdge(on) ? (Index)m_edges[m_edges[on].next].vert : -1;
+    if (!(0 <= w && w < V)) return err | VALID_TOPOLOGY;
+    if (Delaunay_bPointInCircumCircle(a, b, c, m_verts[w])) err |= VALID_NON_DELAUNAY;
+  }
+  return err;
+}
+
+
+
+template <class Real, class IndexType>
+ValidationReport DelaunayMeshT<Real, IndexType>::ValidateEdges(const Index* hs, Index n) const
+{
+  ValidationReport r;
+  Index num_edges = 0, num_topology = 0, num_inverted = 0, num_non_delaunay = 0;
+
+#pragma omp parallel reduction(+:num_edges, num_topology, num_inverted, num_non_delaunay)
+  {
+    std::vector<Index> my_bad;
+
+#pragma omp for schedule(static)
+    for (Index i = 0; i < n; ++i)
+    {
+      const Index h = hs ? hs[i] : i;
+      if (m_edges[h].face < 0) continue;
+      ++num_edges;
+
+      const int err = ValidateEdge(h);
+      if (err == 0) continue;
+      if (err & VALID_TOPOLOGY    ) ++num_topology;
+      if (err & VALID_INVERTED    ) ++num_inverted;
+      if (err & VALID_NON_DELAUNAY) ++num_non_delaunay;
+      my_bad.push_back(h);
+    }
+
+#pragma omp critical
+    r.bad_edges.insert(r.bad_edges.end(), my_bad.begin(), my_bad.end());
+  }
+
+  std::sort(r.bad_edges.begin(), r.bad_edges.end());
+  r.num_edges        = num_edges;
+  r.num_topology     = num_topology;
+  r.num_inverted     = num_inverted;
+  r.num_non_delaunay = num_non_delaunay;
+  return r;
+}
+
+
+
+template <class Real, class IndexType>
+ValidationReport DelaunayMeshT<Real, IndexType>::Validate() const
+{
+  return ValidateEdges(nullptr, (Index)m_edges.size());
+}
+
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::SetDirtyTracking(bool on)
+{
+  m_track_dirty = on;
+  MarkAllDirty();
+}
+
+
+
+template <class Real, class IndexType>
+ValidationReport DelaunayMeshT<Real, IndexType>::ValidateDirty()
+{
+  if (m_dirty_all)
+  {
+    MarkAllDirty();
+    m_dirty_all = false;
+    return Validate();
+  }
+
+  //edges of the faces on both sides of each recorded edge
+  const Index E = (Index)m_edges.size();
+  if ((Index)m_dirty_mark.size() < E) m_dirty_mark.resize(E, 0);
+
+  std::vector<Index>& hs = m_dirty_check;
+  hs.clear();
+  for (const Index d : m_dirty_edges)
+  {
+    if (E <= d || m_edges[d].face < 0) continue;
+    for (const Index s : { d, (Index)m_edges[d].oppo })
+    {
+      if (s < 0 || E <= s || m_edges[s].face < 0) continue;
+      Index e = s;
+      for (Index k = 0; k < 3 && 0 <= e && e < E; ++k, e = m_edges[e].next)
+      {
+        if (m_dirty_mark[e] & 2) continue;
+        m_dirty_mark[e] |= 2;
+        hs.push_back(e);
+      }
+    }
+  }
+  for (const Index e : hs) m_dirty_mark[e] = 0;
+  for (const Index e : m_dirty_edges) m_dirty_mark[e] = 0;
+  m_dirty_edges.clear();
+
+  return ValidateEdges(hs.data(), (Index)hs.size());
+}
+
+
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::GetFaceVsEs(
+  Index fidx,
+  Index& e0, Index& e1, Index& e2,
+  Index& v0, Index& v1, Index& v2) const
+{
+  e0 = m_faces[fidx].edge;
+  e1 = m_edges[e0].next;
+  e2 = m_edges[e1].next;
+  v0 = m_edges[e0].vert;
+  v1 = m_edges[e1].vert;
+  v2 = m_edges[e2].vert;
+}
+
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::InitByVsFs(
+  const std::vector<std::array<double, 2>>& verts,
+  const std::vector<std::array<Index, 3>>& faces)
+{
+  std::vector<Vert> local;
+  SetOrigin(verts);
+  ToLocal(verts, local);
+  InitByVsFsLocal(local, faces);
+}
+
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::InitByVsFsLocal(
+  std::vector<Vert>& verts,
+  const std::vector<std::array<Index, 3>>& faces)
+{
+  const Index V = (Index)verts.size();
+  const Index F = (Index)faces.size();
+  const Index E = 3 * F;
+
+  m_verts.swap(verts);
+  for (auto& v : m_verts) v.edge = -1;
+
+  //face fi has edges 3fi, 3fi+1, 3fi+2
+  m_faces.resize(F);
+  m_edges.resize(E);
+
+#pragma omp parallel for
+  for (Index fi = 0; fi < F; ++fi)
+  {
+    m_faces[fi].edge = 3 * fi;
+    for (Index k = 0; k < 3; ++k)
+      m_edges[3 * fi + k] = Edge(faces[fi][k], -1, 3 * fi + (k + 1) % 3, fi);
+  }
+
+  //vertex has the last outgoing edge
+  for (Index e = 0; e < E; ++e) m_verts[m_edges[e].vert].edge = e;
+
+  //min(v0,v1) or max(v0,v1) of the end points of edge e
+  auto Key = [&](Index e, bool min_key) {
+    const Index v0 = m_edges[e].vert, v1 = m_edges[m_edges[e].next].vert;
+    return min_key ? std::min(v0, v1) : std::max(v0, v1);
+  };
+
+  //bucket edges by min(v0,v1), each bucket sorted by max(v0,v1) : counting 
+  //sort by max, then stable counting sort by min (linear, CSR)
+  std::vector<Index> bucket_begin(V + 1);
+  std::vector<Index> by_max(E), bucket_edges(E);
+  auto SortByKey = [&](bool min_key, std::vector<Index>& dst) {
+    std::fill(bucket_begin.begin(), bucket_begin.end(), 0);
+    for (Index e = 0; e < E; ++e) ++bucket_begin[Key(e, min_key) + 1];
+    for (Index v = 0; v < V; ++v) bucket_begin[v + 1] += bucket_begin[v];
+
+    std::vector<Index> fill(bucket_begin.begin(), bucket_begin.end() - 1);
+    for (Index i = 0; i < E; ++i) 
+    {
+      const Index e = min_key ? by_max[i] : i;
+      dst[fill[Key(e, min_key)]++] = e;
+    }
+  };
+  SortByKey(false, by_max);
+  SortByKey(true , bucket_edges);
+
+  //edges of the same pair (min,max) are neighbors in the bucket, 
+  //match v0->v1 and v1->v0 in each run (2 edges in a manifold mesh)
+#pragma omp parallel for schedule(dynamic, 1024)
+  for (Index v = 0; v < V; ++v)
+  {
+    const Index end = bucket_begin[v + 1];
+    for (Index i = bucket_begin[v]; i < end; )
+    {
+      const Index key = Key(bucket_edges[i], false);
+      Index run = i + 1;
+      while (run < end && Key(bucket_edges[run], false) == key) ++run;
+
+      for (; i < run; ++i)
+      {
+        const Index ei = bucket_edges[i];
+        if (m_edges[ei].oppo != -1) continue;
+        const Index ai = m_edges[ei].vert, bi = m_edges[m_edges[ei].next].vert;
+
+        for (Index j = i + 1; j < run; ++j)
+        {
+          const Index ej = bucket_edges[j];
+          if (m_edges[ej].oppo != -1) continue;
+          if (m_edges[ej].vert != bi || m_edges[m_edges[ej].next].vert != ai) continue;
+          m_edges[ei].oppo = ej;
+          m_edges[ej].oppo = ei;
+          break;
+        }
+      }
+    }
+  }
+
+  m_walk_face = 0;
+  m_convex = false;
+  ClearFreeLists();
+  MarkAllDirty();
+}
+
+
+
+template <class Real, class IndexType>
+double DelaunayMeshT<Real, IndexType>::CalcAverateEdgeLength()
+{
+  double sum = 0;
+  Index    num = 0;
+  for (Index i : Edges())
+  {
+      Index v1 = m_edges[i].vert;
+      Index v2 = m_edges[m_edges[i].next].vert;
+      sum += Vert::Distance(m_verts[v1], m_verts[v2]);
+      ++num;
+  }
+  return sum / (double) num;
+}
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::RemoveBoundingFacesWithLongEdge(double r)
+{
+  const Index F = (Index)m_faces.size();
+  const double r2 = r * r;
+
+  auto HasLongEdge = [&](Index f) {
+    Index e0, e1, e2, v0, v1, v2;
+    GetFaceVsEs(f, e0, e1, e2, v0, v1, v2);
+    return Vert::DistanceSq(m_verts[v0], m_verts[v1]) > r2 ||
+           Vert::DistanceSq(m_verts[v1], m_verts[v2]) > r2 ||
+           Vert::DistanceSq(m_verts[v2], m_verts[v0]) > r2;
+  };
+
+  //step1 peel faces from the boundary (a face is visited when it is on 
+  //the boundary : it has an edge with oppo == -1 or its neighbor is removed)
+  //tombstones are dead from the start
+  std::vector<char> face_dead(F, 0);
+  std::vector<Index>  queue;
+  queue.reserve(F);
+
+  for (Index f = 0; f < F; ++f) face_dead[f] = (m_faces[f].edge < 0) ? 1 : 0;
+  for (Index f : Faces())
+  {
+    Index e0, e1, e2, v0, v1, v2;
+    GetFaceVsEs(f, e0, e1, e2, v0, v1, v2);
+    if (m_edges[e0].oppo == -1 || m_edges[e1].oppo == -1 || m_edges[e2].oppo == -1) 
+      queue.push_back(f);
+  }
+
+  for (size_t head = 0; head < queue.size(); ++head)
+  {
+    const Index f = queue[head];
+    if (face_dead[f] || !HasLongEdge(f)) continue;
+
+    face_dead[f] = 1;
+    const Index e0 = m_faces[f].edge;
+    const Index e1 = m_edges[e0].next;
+    const Index e2 = m_edges[e1].next;
+    for (Index e : {e0, e1, e2})
+    {
+      const Index oppo = m_edges[e].oppo;
+      if (oppo == -1) continue;
+      const Index nf = m_edges[oppo].face;
+      if (!face_dead[nf]) queue.push_back(nf);
+    }
+  }
+
+  //step2 remove verts that are not used by remaining faces
+  std::vector<char> vert_dead(m_verts.size(), 1);
+  for (Index f = 0; f < F; ++f)
+  {
+    if (face_dead[f]) continue;
+    Index e0, e1, e2, v0, v1, v2;
+    GetFaceVsEs(f, e0, e1, e2, v0, v1, v2);
+    vert_dead[v0] = vert_dead[v1] = vert_dead[v2] = 0;
+  }
+
+  //step3 compact in place
+  RemoveFaces(face_dead, vert_dead);
+}
+
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::MoveVertsToVolonoiCenter(
+  RelaxCenter center,
+  const std::vector<std::array<double, 2>>& clip)
+{
+  std::vector<std::array<double, 2>> centers, local_clip;
+  ToLocal(clip, local_clip);
+  CalcVoronoiCenters(center, local_clip, centers);
+
+#pragma omp parallel for
+  for (Index i = 0; i < (Index)m_verts.size(); ++i)
+  {
+    m_verts[i].x = (Real)centers[i][0];
+    m_verts[i].y = (Real)centers[i][1];
+  }
+  MarkAllDirty();
+}
+
+
+
+//clip polygon poly by convex polygon clip (ccw) (Sutherland-Hodgman)
+static void Delaunay_ClipPolygon(
+  const std::vector<std::array<double, 2>>& clip,
+  std::vector<std::array<double, 2>>& poly,
+  std::vector<std::array<double, 2>>& tmp)
+{
+  const Index C = (Index)clip.size();
+  for (Index i = 0; i < C && !poly.empty(); ++i)
+  {
+    const auto& a = clip[i];
+    const auto& b = clip[(i + 1) % C];
+    auto Side = [&](const std::array<double, 2>& p) {
+      return (b[0] - a[0]) * (p[1] - a[1]) - (b[1] - a[1]) * (p[0] - a[0]);
+    };
+
+    tmp.clear();
+    const Index P = (Index)poly.size();
+    for (Index k = 0; k < P; ++k)
+    {
+      const auto& p = poly[k];
+      const auto& q = poly[(k + 1) % P];
+      const double sp = Side(p), sq = Side(q);
+      if (sp >= 0) tmp.push_back(p);
+      if ((sp >= 0) != (sq >= 0))
+      {
+        const double t = sp / (sp - sq);
+        tmp.push_back({ p[0] + t * (q[0] - p[0]), p[1] + t * (q[1] - p[1]) });
+      }
+    }
+    poly.swap(tmp);
+  }
+}
+
+
+
+//moments of a simple polygon (cw or ccw) about point p
+//area, centroid (cx,cy) and energy = integral of |x - p|^2 over the polygon
+static bool Delaunay_PolygonMoments(
+  const std::vector<std::array<double, 2>>& poly,
+  const double px, const double py,
+  double& area, double& cx, double& cy, double& energy)
+{
+  const Index P = (Index)poly.size();
+  if (P < 3) return false;
+
+  //sum of triangles (p, poly[k], poly[k+1]) relative to p
+  double a = 0, x = 0, y = 0, E = 0;
+  for (Index k = 0; k < P; ++k)
+  {
+    const double ax = poly[k][0] - px,           ay = poly[k][1] - py;
+    const double bx = poly[(k + 1) % P][0] - px, by = poly[(k + 1) % P][1] - py;
+    const double c = ax * by - bx * ay;
+    a += c;
+    x += c * (ax + bx);
+    y += c * (ay + by);
+    E += c * (ax * ax + ax * bx + bx * bx + ay * ay + ay * by + by * by);
+  }
+  if (a == 0) return false;
+
+  area   = std::abs(0.5 * a);
+  cx     = px + x / (3.0 * a);
+  cy     = py + y / (3.0 * a);
+  energy = ((a > 0) ? E : -E) / 12.0;
+  return true;
+}
+
+
+
+//voronoi cell of interior vert[vidx] : circumcenters of the faces around it
+//(clipped by convex polygon clip if it is not empty)
+//returns false for boundary verts
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::CalcVoronoiCell(
+  Index vidx,
+  const std::vector<std::array<double, 2>>& clip,
+  std::vector<std::array<double, 2>>& cell,
+  std::vector<std::array<double, 2>>& tmp) const
+{
+  cell.clear();
+  if (IsConstrainedEndpoint(vidx)) return false;
+  for (Index e : OutEdges(vidx))
+  {
+    if (m_edges[e].oppo == -1) return false;
+
+    Index e0, e1, e2, v0, v1, v2;
+    GetFaceVsEs(m_edges[e].face, e0, e1, e2, v0, v1, v2);
+    double cx, cy, cr;
+    if (!Delaunay_CircumCircle(m_verts[v0], m_verts[v1], m_verts[v2], cx, cy, cr)) return false;
+    cell.push_back({ cx, cy });
+  }
+  if (!clip.empty()) Delaunay_ClipPolygon(clip, cell, tmp);
+  return cell.size() >= 3;
+}
+
+
+
+//centers[i] : new position of vert[i] for the relaxation 
+//(boundary verts keep their position)
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::CalcVoronoiCenters(
+  RelaxCenter center,
+  const std::vector<std::array<double, 2>>& clip,
+  std::vector<std::array<double, 2>>& centers)
+{
+  const Index V = (Index)m_verts.size();
+  centers.resize(V);
+
+#pragma omp parallel
+  {
+    //work buffers of each thread
+    std::vector<std::array<double, 2>> cell, tmp;
+
+#pragma omp for schedule(dynamic, 1024)
+    for (Index i = 0; i < V; ++i)
+    {
+      const Vert& p = m_verts[i];
+      centers[i] = { p.x, p.y };
+
+      if (center == RelaxCenter::ONE_RING_AVERAGE)
+      {
+        if (IsConstrainedEndpoint(i)) continue;
+
+        Index n = 0;
+        double x = 0, y = 0;
+        for (Index e : OutEdges(i))
+        {
+          if (m_edges[e].oppo == -1)
+          {
+            n = 0;
+            break;
+          }
+          const Vert& v = m_verts[m_edges[m_edges[e].next].vert];
+          x += v.x;
+          y += v.y;
+          ++n;
+        }
+        if (n > 0) centers[i] = { x / n, y / n };
+        continue;
+      }
+
+      double area, cx, cy, energy;
+      if (CalcVoronoiCell(i, clip, cell, tmp) && 
+          Delaunay_PolygonMoments(cell, p.x, p.y, area, cx, cy, energy)) 
+        centers[i] = { cx, cy };
+    }
+  }
+}
+
+
+
+/*-----------------------------
+* Lloyd relaxation without rebuilding the mesh
+* 
+* each interior vertex moves to CalcVoronoiCenters one by one.
+* if the new position is in the kernel of its star, the mesh stays valid 
+* and only the edges around the star are checked by Lawson flips.
+* otherwise (a triangle would be inverted) the vertex is detached from 
+* the mesh by flips and inserted again at the new position.
+-----------------------------*/
+
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::LloydRelaxation(
+  int iterations,
+  RelaxCenter center,
+  const std::vector<std::array<double, 2>>& clip)
+{
+  std::vector<std::array<double, 2>> centers, local_clip;
+  std::vector<Index> order;
+  Index reinserted = 0;
+
+  m_unmoved_count = 0;
+  ToLocal(clip, local_clip);
+  CalcHilbertOrder(order);
+  for (int it = 0; it < iterations; ++it)
+  {
+    CalcVoronoiCenters(center, local_clip, centers);
+    reinserted += MoveVertsWithRepair(centers, order);
+  }
+  return reinserted;
+}
+
+
+
+//order[k] : verts sorted along the hilbert curve, so that consecutive 
+//repairs touch near memory 
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::CalcHilbertOrder(std::vector<Index>& order) const
+{
+  std::vector<std::array<double, 2>> points(m_verts.size());
+  for (Index i = 0; i < (Index)m_verts.size(); ++i) points[i] = { m_verts[i].x, m_verts[i].y };
+  double minx = 0, miny = 0, maxx = 0, maxy = 0;
+  Delaunay_CalcBoundingBox(points, minx, miny, maxx, maxy);
+  Delaunay_CalcInsertOrder(points, minx, miny, maxx, maxy, InsertOrder::HILBERT, order);
+}
+
+
+
+//move vert[v] to pos[v] for v in order, and repair the mesh by flips
+//returns the number of re-inserted verts
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::MoveVertsWithRepair(
+  const std::vector<std::array<double, 2>>& pos,
+  const std::vector<Index>& order)
+{
+  std::vector<Index> Q;
+  Index reinserted = 0;
+
+  for (const Index v : order)
+  {
+    //the stored position (MoveVertexInStar tests it exactly)
+    const double x = (Real)pos[v][0], y = (Real)pos[v][1];
+    if (x == m_verts[v].x && y == m_verts[v].y) continue;
+
+    Q.clear();
+    if (!MoveVertexInStar(v, x, y, Q))
+    {
+      if (ReinsertVertex(v, x, y, Q)) ++reinserted;
+      else ++m_unmoved_count;
+    }
+    RepairByFlips(Q);
+  }
+  return reinserted;
+}
+
+
+/*-----------------------------
+* CVT energy and its minimization by L-BFGS
+* 
+* F = sum_i integral_{cell i} |x - p_i|^2 dx 
+* dF/dp_i = 2 m_i (p_i - c_i)   (m_i : area, c_i : centroid of cell i)
+* 
+* the inverse hessian starts from diag(1 / 2m_i) so that the first step 
+* is the Lloyd step. each trial point of the line search moves the verts 
+* by MoveVertsWithRepair (flips / re-insertion), then F is evaluated on 
+* the repaired Delaunay mesh.
+-----------------------------*/
+
+template <class Real, class IndexType>
+double DelaunayMeshT<Real, IndexType>::CalcCVTEnergy(
+  const std::vector<std::array<double, 2>>& clip,
+  std::vector<std::array<double, 2>>& grad,
+  std::vector<double>& area) const
+{
+  const Index V = (Index)m_verts.size();
+  grad.assign(V, { 0, 0 });
+  area.assign(V, 0);
+  double energy = 0;
+
+  std::vector<std::array<double, 2>> local_clip;
+  ToLocal(clip, local_clip);
+
+#pragma omp parallel reduction(+:energy)
+  {
+    std::vector<std::array<double, 2>> cell, tmp;
+
+#pragma omp for schedule(dynamic, 1024)
+    for (Index i = 0; i < V; ++i)
+    {
+      const Vert& p = m_verts[i];
+      double m, cx, cy, e;
+      if (!CalcVoronoiCell(i, local_clip, cell, tmp) || 
+          !Delaunay_PolygonMoments(cell, p.x, p.y, m, cx, cy, e)) continue;
+
+      energy += e;
+      area[i] = m;
+      grad[i] = { 2 * m * (p.x - cx), 2 * m * (p.y - cy) };
+    }
+  }
+  return energy;
+}
+
+
+
+static double Delaunay_Dot(
+  const std::vector<std::array<double, 2>>& a,
+  const std::vector<std::array<double, 2>>& b)
+{
+  double s = 0;
+  for (Index i = 0; i < (Index)a.size(); ++i) s += a[i][0] * b[i][0] + a[i][1] * b[i][1];
+  return s;
+}
+
+
+
+template <class Real, class IndexType>
+int DelaunayMeshT<Real, IndexType>::OptimizeCVT(
+  int max_iterations,
+  const std::vector<std::array<double, 2>>& clip,
+  int history,
+  double grad_tol)
+{
+  typedef std::vector<std::array<double, 2>> Vec2s;
+  const Index V = (Index)m_verts.size();
+
+  std::vector<Index> order;
+  CalcHilbertOrder(order);
+  m_unmoved_count = 0;
+
+  Vec2s x(V), g, x_new(V), g_new, d(V), s(V), y(V);
+  std::vector<double> m, m_new;
+  std::vector<Vec2s>  S, Y;
+  std::vector<double> rho, alpha;
+
+  for (Index i = 0; i < V; ++i) x[i] = { m_verts[i].x, m_verts[i].y };
+  double f = CalcCVTEnergy(clip, g, m);
+
+  int it = 0;
+  for (; it < max_iterations; ++it)
+  {
+    if (std::sqrt(Delaunay_Dot(g, g)) < grad_tol) break;
+
+    //d = -H g (two loop recursion)
+    const Index K = (Index)S.size();
+    alpha.resize(K);
+    d = g;
+    for (Index k = K - 1; k >= 0; --k)
+    {
+      alpha[k] = rho[k] * Delaunay_Dot(S[k], d);
+      for (Index i = 0; i < V; ++i) 
+      {
+        d[i][0] -= alpha[k] * Y[k][i][0];
+        d[i][1] -= alpha[k] * Y[k][i][1];
+      }
+    }
+    for (Index i = 0; i < V; ++i)
+    {
+      const double h = (m[i] > 0) ? 0.5 / m[i] : 0;
+      d[i][0] *= h;
+      d[i][1] *= h;
+    }
+    for (Index k = 0; k < K; ++k)
+    {
+      const double beta = rho[k] * Delaunay_Dot(Y[k], d);
+      for (Index i = 0; i < V; ++i) 
+      {
+        d[i][0] += (alpha[k] - beta) * S[k][i][0];
+        d[i][1] += (alpha[k] - beta) * S[k][i][1];
+      }
+    }
+    for (auto& di : d) di = { -di[0], -di[1] };
+
+    //not a descent direction : restart from the Lloyd step
+    double gd = Delaunay_Dot(g, d);
+    if (gd >= 0)
+    {
+      S.clear(); 
+      Y.clear(); 
+      rho.clear();
+      for (Index i = 0; i < V; ++i)
+      {
+        const double h = (m[i] > 0) ? 0.5 / m[i] : 0;
+        d[i] = { -h * g[i][0], -h * g[i][1] };
+      }
+      gd = Delaunay_Dot(g, d);
+      if (gd >= 0) break;
+    }
+
+    //backtracking line search (Armijo)
+    double step = 1.0, f_new = f;
+    bool accepted = false;
+    for (Index ls = 0; ls < 10 && !accepted; ++ls, step *= 0.5)
+    {
+      for (Index i = 0; i < V; ++i) x_new[i] = { x[i][0] + step * d[i][0], x[i][1] + step * d[i][1] };
+      MoveVertsWithRepair(x_new, order);
+
+      //a vert may stay at its position if the target is out of the mesh
+      for (Index i = 0; i < V; ++i) x_new[i] = { m_verts[i].x, m_verts[i].y };
+      f_new = CalcCVTEnergy(clip, g_new, m_new);
+      accepted = (f_new <= f + 1e-4 * step * gd);
+    }
+    if (!accepted)
+    {
+      MoveVertsWithRepair(x, order);
+      break;
+    }
+
+    //update the history 
+    for (Index i = 0; i < V; ++i)
+    {
+      s[i] = { x_new[i][0] - x[i][0], x_new[i][1] - x[i][1] };
+      y[i] = { g_new[i][0] - g[i][0], g_new[i][1] - g[i][1] };
+    }
+    const double sy = Delaunay_Dot(s, y);
+    if (sy > 0)
+    {
+      if ((Index)S.size() >= history)
+      {
+        S.erase(S.begin());
+        Y.erase(Y.begin());
+        rho.erase(rho.begin());
+      }
+      S.push_back(s);
+      Y.push_back(y);
+      rho.push_back(1.0 / sy);
+    }
+
+    x.swap(x_new);
+    g.swap(g_new);
+    m.swap(m_new);
+    f = f_new;
+  }
+  return it;
+}
+
+
+
+
+//move interior vert[vidx] to (x,y) if no face of its star is inverted 
+//edges of the star are pushed to Q
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::MoveVertexInStar(Index vidx, double x, double y, std::vector<Index>& Q)
+{
+  const Index piv_edge = m_verts[vidx].edge;
+  if (piv_edge < 0) return false;
+
+  Index e = piv_edge;
+  do
+  {
+    const Index n = m_edges[e].next;
+    if (m_edges[e].oppo == -1) return false;
+
+    const Vert& a = m_verts[m_edges[n].vert];
+    const Vert& b = m_verts[m_edges[m_edges[n].next].vert];
+    if (Orient2d(a.x, a.y, b.x, b.y, x, y) <= 0) return false;
+
+    e = m_edges[m_edges[e].oppo].next;
+  } 
+  while (e != piv_edge);
+
+  m_verts[vidx].x = (Real)x;
+  m_verts[vidx].y = (Real)y;
+
+  do
+  {
+    Q.push_back(e);
+    Q.push_back(m_edges[e].next);
+    e = m_edges[m_edges[e].oppo].next;
+  } 
+  while (e != piv_edge);
+  return true;
+}
+
+
+
+//detach interior vert[vidx] and insert it at (x,y) (in a face, or on an 
+//interior edge that is not constrained). otherwise (outside of the mesh, 
+//on a vert or a segment) vert[vidx] is inserted at the original position
+//and false is returned. changed edges are pushed to Q
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::ReinsertVertex(Index vidx, double x, double y, std::vector<Index>& Q)
+{
+  const Index f = DetachVertex(vidx, Q);
+  if (f < 0) return false;
+
+  const double ox = m_verts[vidx].x, oy = m_verts[vidx].y;
+  m_walk_face = f;
+
+  //the walk falls back to a linear scan on a non convex mesh
+  bool onEdge;
+  Index e0idx;
+  Index f0idx = SearchFaceCotainPoint(x, y, -1, onEdge, e0idx);
+  const bool moved = f0idx >= 0 && 
+    (!onEdge || (e0idx >= 0 && m_edges[e0idx].oppo != -1 && !m_edges[e0idx].IsConstrained()));
+  if (!moved)
+  {
+    f0idx  = f;
+    onEdge = false;
+    x = ox;
+    y = oy;
+  }
+  m_verts[vidx].x = (Real)x;
+  m_verts[vidx].y = (Real)y;
+
+  //takes back the slots freed by DetachVertex
+  Index fs[2], es[6];
+  for (auto& fi : fs) fi = NewFace();
+  for (auto& ei : es) ei = NewEdge();
+  if (onEdge) InsertVertexToEdge(e0idx, vidx, fs, es, m_flip_stack);
+  else        InsertVertexToFace(f0idx, vidx, fs, es, m_flip_stack);
+
+  //faces around vidx may not be Delaunay because the hole was filled by 
+  //arbitrary flips (vidx is interior : inserted into a face or an interior edge)
+  const Index piv_edge = m_verts[vidx].edge;
+  Index e = piv_edge;
+  do
+  {
+    Q.push_back(e);
+    e = m_edges[m_edges[e].oppo].next;
+  } 
+  while (e != piv_edge);
+  return moved;
+}
+
+
+
+//reduce the valence of interior vert[vidx] to 3 by flipping its edges and 
+//merge its three faces into one. returns the merged face (-1 if failed)
+//the two other faces and the six edges are freed (tombstones)
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::DetachVertex(Index vidx, std::vector<Index>& Q)
+{
+  const Index piv_edge = m_verts[vidx].edge;
+  if (piv_edge < 0) return -1;
+
+  //vidx should be interior
+  Index valence = 0;
+  Index e = piv_edge;
+  do
+  {
+    if (m_edges[e].oppo == -1) return -1;
+    Q.push_back(m_edges[e].next);
+    ++valence;
+    e = m_edges[m_edges[e].oppo].next;
+  } 
+  while (e != piv_edge);
+
+  //flip an edge (vidx, u) whose two faces form a convex quad
+  while (valence > 3)
+  {
+    Index flip = -1;
+    e = m_verts[vidx].edge;
+    for (Index k = 0; k < valence && flip < 0; ++k)
+    {
+      const Index o  = m_edges[e].oppo;
+      const Vert& v  = m_verts[vidx];
+      const Vert& u  = m_verts[m_edges[o].vert];
+      const Vert& wn = m_verts[m_edges[m_edges[m_edges[e].next].next].vert];
+      const Vert& wp = m_verts[m_edges[m_edges[m_edges[o].next].next].vert];
+      if (Orient2d(wp.x, wp.y, u.x, u.y, wn.x, wn.y) > 0 && 
+          Orient2d(wn.x, wn.y, v.x, v.y, wp.x, wp.y) > 0) flip = e;
+      else e = m_edges[o].next;
+    }
+    if (flip < 0) return -1;
+
+    //FlipEdge moves vert[vidx].edge to the next remaining edge
+    FlipEdge(flip);
+    Q.push_back(flip);
+    --valence;
+  }
+
+  //merge the three faces 
+  Index s[3], l[3];
+  s[0] = m_verts[vidx].edge;
+  for (Index i = 0; i < 3; ++i)
+  {
+    l[i] = m_edges[s[i]].next;
+    if (i < 2) s[i + 1] = m_edges[m_edges[s[i]].oppo].next;
+  }
+
+  const Index f = m_edges[s[0]].face;
+  for (Index i = 0; i < 3; ++i)
+  {
+    const Index fi = m_edges[s[i]].face;
+    const Index in = m_edges[s[i]].oppo;
+    if (fi != f) FreeFace(fi);
+    FreeEdge(s[i]);
+    FreeEdge(in);
+  }
+
+  //s[i+1] is on the right side of s[i], so l[i] ends where l[i-1] starts
+  for (Index i = 0; i < 3; ++i)
+  {
+    m_edges[l[i]].SetNextFace(l[(i + 2) % 3], f);
+    m_verts[m_edges[l[i]].vert].edge = l[i];
+  }
+  m_faces[f].edge = l[0];
+  m_verts[vidx].edge = -1;
+  for (Index i = 0; i < 3; ++i) MarkDirty(l[i]);
+  return f;
+}
+
+
+
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::RepairByFlips(std::vector<Index>& Q)
+{
+  Index flips = 0;
+  while (!Q.empty())
+  {
+    const Index e = Q.back();
+    Q.pop_back();
+    MarkDirty(e);
+    if (m_edges[e].face < 0 || !FlipIfNotDelaunay(e)) continue;
+
+    const Index o = m_edges[e].oppo;
+    Q.push_back(m_edges[e].next);
+    Q.push_back(m_edges[m_edges[e].next].next);
+    Q.push_back(m_edges[o].next);
+    Q.push_back(m_edges[m_edges[o].next].next);
+    ++flips;
+  }
+  return flips;
+}
+
+
+
+/*-----------------------------
+* Delaunay restoration of a given triangulation (Lawson flips)
+*
+* the work list starts with every interior edge (one half edge per edge) 
+* and a flipped edge adds the four edges of its quad (same as RepairByFlips)
+*
+* parallel mode works in rounds over the work list. a thread locks the 
+* five edges of the quad of an edge (both half edges by one lock) before 
+* testing it, and an edge whose quad is locked by other thread is retried 
+* in the next round. small rounds run in one thread (no conflict).
+*
+* memory model : a flip writes only the six half edges and two faces of its
+* quad, so every writer of a face holds the locks of all its edges. the 
+* edge lock of a work item needs no read (its index is the smaller half 
+* edge, and oppo is never changed by flips), and once it is held, both 
+* faces of the edge are stable and the rest of the quad is read and locked. 
+* the lock (acquire) / unlock (release) pairs order the accesses of 
+* different threads. the edges of the quad verts are shared with other 
+* quads, so they are set by a serial pass over the flipped edges after 
+* each round (m_defer_vert_edges)
+-----------------------------*/
+
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::MakeDelaunay(bool parallel)
+{
+  std::vector<Index> work;
+  work.reserve(m_edges.size() / 2);
+  for (Index e : Edges())
+  {
+    if (m_edges[e].oppo > e && !m_edges[e].IsConstrained()) work.push_back(e);
+  }
+
+  if (!parallel) return RepairByFlips(work);
+
+  //threads do not record dirty edges
+  MarkAllDirty();
+
+  //lock of edge {e, oppo} is edge_lock[min(e, oppo)]
+  std::vector<std::atomic<int>> edge_lock(m_edges.size());
+  for (auto& l : edge_lock) l.store(0);
+
+  Index flips = 0;
+  std::vector<Index> next, flipped;
+  while (!work.empty())
+  {
+    const Index W = (Index)work.size();
+    next.clear();
+    flipped.clear();
+
+    m_defer_vert_edges = true;
+#pragma omp parallel if(W > 1024)
+    {
+      std::vector<Index> my_next, my_flipped;
+
+      auto Key = [&](Index e) {
+        const Index o = m_edges[e].oppo;
+        return (o == -1) ? e : std::min(e, o);
+      };
+      auto Lock = [&](Index k) -> bool {
+        int expect = 0;
+        return edge_lock[k].compare_exchange_strong(expect, 1, std::memory_order_acquire);
+      };
+      auto Unlock = [&](Index k) { 
+        edge_lock[k].store(0, std::memory_order_release); 
+      };
+      auto Push = [&](Index e) {
+        const Index o = m_edges[e].oppo;
+        if (o != -1 && !m_edges[e].IsConstrained()) my_next.push_back(std::min(e, o));
+      };
+
+#pragma omp for schedule(dynamic, 256)
+      for (Index i = 0; i < W; ++i)
+      {
+        //e < oppo (the key of the edge)
+        const Index e = work[i];
+        if (!Lock(e)) 
+        { 
+          my_next.push_back(e); 
+          continue; 
+        }
+
+        //the other edges of the quad (their indices do not change by the flip)
+        const Index o = m_edges[e].oppo;
+        const Index quad[4] = { m_edges[e].next, m_edges[m_edges[e].next].next, 
+                                m_edges[o].next, m_edges[m_edges[o].next].next };
+        Index n = 0;
+        while (n < 4 && Lock(Key(quad[n]))) ++n;
+
+        if (n == 4 && FlipIfNotDelaunay(e))
+        {
+          for (const Index q : quad) Push(q);
+          my_flipped.push_back(e);
+        }
+        else if (n < 4)
+        {
+          my_next.push_back(e);
+        }
+        for (Index k = 0; k < n; ++k) Unlock(Key(quad[k]));
+        Unlock(e);
+      }
+
+#pragma omp critical
+      {
+        next   .insert(next   .end(), my_next   .begin(), my_next   .end());
+        flipped.insert(flipped.end(), my_flipped.begin(), my_flipped.end());
+      }
+    }
+    m_defer_vert_edges = false;
+
+    //edges of the verts of the flipped quads
+    for (const Index e : flipped)
+    {
+      for (Index h : { e, (Index)m_edges[e].oppo })
+      {
+        for (Index k = 0; k < 3; ++k, h = m_edges[h].next) 
+          m_verts[m_edges[h].vert].edge = h;
+      }
+    }
+
+    //an edge may be added by both of its quads
+    std::sort(next.begin(), next.end());
+    next.erase(std::unique(next.begin(), next.end()), next.end());
+    work.swap(next);
+    flips += (Index)flipped.size();
+  }
+  return flips;
+}
+
+
+
+/*-----------------------------
+* vertex deletion
+* 
+* interior vertex : the star polygon (link edges) is retriangulated by 
+*   ear clipping. the convex ear whose circumcircle contains the deleted 
+*   point deepest (max InCircle/Orient, i.e. min power of the point) is 
+*   clipped first, which gives the Delaunay triangulation of the star 
+*   (Devillers). the new edges are checked by flips against round-off 
+*   of the priority.
+* boundary vertex : its faces are removed (the boundary moves inward).
+*   on a convex mesh, the pocket between the new boundary and its convex 
+*   hull is filled by a Graham scan along the boundary (and flips), which 
+*   gives the Delaunay triangulation of the rest, and it stays convex.
+* endpoints of constrained edges are not removed.
+* 
+* freed face/edge slots are reused by the new triangles, and the rest 
+* (and the vertex) become tombstones on the free lists (O(valence)).
+* indices of the other elements never change.
+-----------------------------*/
+
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::IsConstrainedEndpoint(Index vidx) const
+{
+  Index first = -1;
+  for (Index e : OutEdges(vidx))
+  {
+    if (m_edges[e].IsConstrained()) return true;
+    if (first < 0) first = e;
+  }
+  if (first < 0) return false;
+
+  //a constrained boundary edge is a single half edge, the incoming one 
+  //(b -> vidx, the prev of the most counter clockwise spoke) is not a spoke
+  const Index in = m_edges[m_edges[first].next].next;
+  return m_edges[in].oppo == -1 && m_edges[in].IsConstrained();
+}
+
+
+
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::RemoveVertex(Index vidx)
+{
+  if (vidx < 0 || (Index)m_verts.size() <= vidx || m_verts[vidx].edge < 0) return false;
+
+  //spokes of vidx, in counter clockwise order
+  std::vector<Index>& spokes = m_rm_spokes;
+  spokes.clear();
+  bool boundary = false;
+  //an endpoint of a constrained edge is kept
+  if (IsConstrainedEndpoint(vidx)) return false;
+  for (Index e : OutEdges(vidx))
+  {
+    spokes.push_back(e);
+    if (m_edges[e].oppo == -1) boundary = true;
+  }
+  std::reverse(spokes.begin(), spokes.end());
+
+  std::vector<Index>& free_fs = m_rm_faces;
+  std::vector<Index>& free_es = m_rm_edges;
+  free_fs.clear();
+  free_es.clear();
+
+  if (boundary)
+  {
+    RemoveBoundaryFan(vidx);
+    return true;
+  }
+
+  const Index K = (Index)spokes.size();
+  for (Index i = 0; i < K; ++i)
+  {
+    free_fs.push_back(m_edges[spokes[i]].face);
+    free_es.push_back(spokes[i]);
+    free_es.push_back(m_edges[spokes[i]].oppo);
+  }
+
+  //polygon : pv[i] -> pv[next[i]] by edge pe[i] 
+  std::vector<Index>&    pv   = m_rm_poly;
+  std::vector<double>& key  = m_rm_key;
+  pv.resize(4 * K);
+  key.resize(K);
+  Index* pe   = &pv[K];
+  Index* prev = &pv[2 * K];
+  Index* next = &pv[3 * K];
+
+  for (Index i = 0; i < K; ++i)
+  {
+    pe[i]   = m_edges[spokes[i]].next;
+    pv[i]   = m_edges[pe[i]].vert;
+    prev[i] = (i + K - 1) % K;
+    next[i] = (i + 1) % K;
+    m_verts[pv[i]].edge = pe[i];
+  }
+
+  const Vert& p = m_verts[vidx];
+  auto EarKey = [&](Index b) {
+    const Vert& A = m_verts[pv[prev[b]]];
+    const Vert& B = m_verts[pv[b]];
+    const Vert& C = m_verts[pv[next[b]]];
+    const double o = Orient2d(A.x, A.y, B.x, B.y, C.x, C.y);
+    if (o <= 0) return -HUGE_VAL;
+    return InCircle(A.x, A.y, B.x, B.y, C.x, C.y, p.x, p.y) / o;
+  };
+  for (Index i = 0; i < K; ++i) key[i] = EarKey(i);
+
+  std::vector<Index>& Q = m_flip_stack;
+  Q.clear();
+  for (Index i = 0; i < K; ++i) Q.push_back(pe[i]);
+
+  Index fslot = 0, eslot = 0, head = 0;
+  for (Index remain = K; remain > 3; --remain)
+  {
+    Index b = head;
+    for (Index i = next[head]; i != head; i = next[i]) if (key[i] > key[b]) b = i;
+    const Index a = prev[b], c = next[b];
+
+    //new face (pv[a], pv[b], pv[c]) and the edge pv[a] -> pv[c] left in the polygon
+    const Index f  = free_fs[fslot++];
+    const Index d1 = free_es[eslot++];
+    const Index d2 = free_es[eslot++];
+    m_edges[d1] = Edge(pv[c], d2, pe[a], f);
+    m_edges[d2] = Edge(pv[a], d1, -1, -1);
+    m_edges[pe[a]].SetNextFace(pe[b], f);
+    m_edges[pe[b]].SetNextFace(d1, f);
+    m_faces[f].edge = pe[a];
+
+    pe[a]   = d2;
+    next[a] = c;
+    prev[c] = a;
+    head    = a;
+    key[a]  = EarKey(a);
+    key[c]  = EarKey(c);
+    Q.push_back(d1);
+  }
+
+  //last triangle
+  {
+    const Index a = head, b = next[a], c = next[b];
+    const Index f = free_fs[fslot++];
+    m_edges[pe[a]].SetNextFace(pe[b], f);
+    m_edges[pe[b]].SetNextFace(pe[c], f);
+    m_edges[pe[c]].SetNextFace(pe[a], f);
+    m_faces[f].edge = pe[a];
+    m_walk_face = f;
+  }
+
+  FreeVert(vidx);
+
+  RepairByFlips(Q);
+
+  //two faces and six edges are left over
+  for (Index i = fslot; i < (Index)free_fs.size(); ++i) FreeFace(free_fs[i]);
+  for (Index i = eslot; i < (Index)free_es.size(); ++i) FreeEdge(free_es[i]);
+  return true;
+}
+
+
+
+//remove the faces around boundary vert[vidx] (m_rm_spokes : its spokes)
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::RemoveBoundaryFan(Index vidx)
+{
+  std::vector<Index>& free_fs = m_rm_faces;
+  std::vector<Index>& free_es = m_rm_edges;
+
+  //the new boundary : pv[0] -> pv[1] -> .. -> pv[K] (from the vert before 
+  //vidx on the boundary to the one after it) by the twins pe[] of the link 
+  //edges, in the reverse order of the spokes. pe = -1 : the link edge was 
+  //on the boundary
+  const Index K = (Index)m_rm_spokes.size();
+  m_rm_poly.resize(2 * K + 1);
+  Index* pv = &m_rm_poly[0];
+  Index* pe = &m_rm_poly[K + 1];
+  for (Index i = 0; i < K; ++i)
+  {
+    const Index l = m_edges[m_rm_spokes[K - 1 - i]].next;
+    pv[i]     = m_edges[m_edges[l].next].vert;
+    pv[i + 1] = m_edges[l].vert;
+    pe[i]     = m_edges[l].oppo;
+  }
+
+  for (Index s : m_rm_spokes)
+  {
+    const Index f = m_edges[s].face;
+    free_fs.push_back(f);
+    free_es.push_back(s);
+    free_es.push_back(m_edges[s].next);
+    free_es.push_back(m_edges[m_edges[s].next].next);
+  }
+  for (Index f : free_fs) FreeFace(f);
+
+  //verts whose edge is removed lose it, then take the twin of a link edge 
+  //(or the edge after it, for the last vert of the link)
+  for (Index e : free_es)
+  {
+    Vert& v = m_verts[m_edges[e].vert];
+    if (0 <= v.edge && m_faces[m_edges[v.edge].face].edge < 0) v.edge = -1;
+  }
+
+  m_walk_face = -1;
+  for (Index e : free_es)
+  {
+    const Index o = m_edges[e].oppo;
+    if (o == -1 || m_faces[m_edges[o].face].edge < 0) continue;
+    m_edges[o].oppo = -1;
+    m_verts[m_edges[o].vert].edge = o;
+    MarkDirty(o);
+    const Index on = m_edges[o].next;
+    if (m_verts[m_edges[on].vert].edge < 0) m_verts[m_edges[on].vert].edge = on;
+    m_walk_face = m_edges[o].face;
+  }
+  for (Index e : free_es) FreeEdge(e);
+  FreeVert(vidx);
+
+  if (m_walk_face < 0) m_walk_face = 0;
+  if (!m_convex || !FillBoundaryPocket(K)) m_convex = false;
+}
+
+
+
+//fill the pocket between the new boundary pv[0] -> .. -> pv[K] (see 
+//RemoveBoundaryFan, pv[0] and pv[K] are on the convex hull) and its convex
+//hull by a Graham scan. pv/pe is used as the stack : for a reflex vert b 
+//of a -> b -> c, the face (b,a,c) is added and a -> c replaces a -> b -> c
+//an edge pe = -1 (a vert left alone by the removal) becomes the boundary 
+//edge of the new face. returns false if such a vert is left alone
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::FillBoundaryPocket(Index K)
+{
+  Index* pv = &m_rm_poly[0];
+  Index* pe = &m_rm_poly[K + 1];
+  std::vector<Index>& Q = m_flip_stack;
+  Q.clear();
+
+  //the stack : pv[0..top+1], pe[0..top]
+  Index top = 0;
+  for (Index i = 1; i < K; ++i)
+  {
+    Index e1 = pe[i];
+    const Index c = pv[i + 1];
+    while (top >= 0)
+    {
+      const Index e0 = pe[top];
+      const Index a  = pv[top];
+      const Index b  = pv[top + 1];
+      if (Orient2d(m_verts[a].x, m_verts[a].y, m_verts[b].x, m_verts[b].y, 
+                   m_verts[c].x, m_verts[c].y) >= 0) break;
+
+      const Index f  = NewFace();
+      const Index t0 = NewEdge();
+      const Index t1 = NewEdge();
+      const Index t2 = NewEdge();
+      m_edges[t0] = Edge(b, e0, t1, f);
+      m_edges[t1] = Edge(a, -1, t2, f);
+      m_edges[t2] = Edge(c, e1, t0, f);
+      m_faces[f].edge = t0;
+      m_verts[a].edge = t1;
+      if (e0 >= 0) { m_edges[e0].oppo = t0; Q.push_back(e0); } 
+      else         m_verts[b].edge = t0;
+      if (e1 >= 0) { m_edges[e1].oppo = t2; Q.push_back(e1); } 
+      else         m_verts[c].edge = t2;
+      MarkDirty(t0);
+      MarkDirty(t1);
+      MarkDirty(t2);
+      m_walk_face = f;
+
+      e1 = t1;
+      --top;
+    }
+    pe[top + 1] = e1;
+    pv[top + 2] = c;
+    ++top;
+  }
+  RepairByFlips(Q);
+
+  for (Index i = 0; i <= top; ++i) if (pe[i] < 0) return false;
+  return true;
+}
+
+
+/*-----------------------------
+* Constrained edges (segments)
+*
+* InsertSegment walks from v0 along the segment and collects the crossed 
+* edges and the two chains of edges on both sides (O(k) for k crossed 
+* edges). the crossed faces are removed and the two pseudo polygons are 
+* retriangulated : for the base edge (a,b), the polygon vert c whose circle 
+* (a,b,c) contains no other polygon vert gives the triangle, and the two 
+* sub polygons (b..c) and (c..a) are processed in the same way (Anglada, 
+* Shewchuk). the result is the constrained Delaunay triangulation without 
+* flips. the choice of c is linear in the polygon size, so the total cost 
+* is O(k log k) for usual inputs (O(k^2) in the worst case).
+*
+* k crossed edges give k + 1 faces and 2k half edges, and the new faces 
+* and edges (including the segment) have the same numbers, so all slots 
+* are reused. a vert on the segment splits it.
+-----------------------------*/
+
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::InsertSegment(Index v0, Index v1)
+{
+  const Index V = (Index)m_verts.size();
+  if (v0 < 0 || V <= v0 || v1 < 0 || V <= v1 || v0 == v1) return false;
+  if (m_verts[v0].edge < 0 || m_verts[v1].edge < 0) return false;
+
+  for (Index v = v0; v != v1; )
+  {
+    v = InsertSubSegment(v, v1);
+    if (v < 0) return false;
+  }
+  return true;
+}
+
+
+
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::InsertSegments(const std::vector<std::array<Index, 2>>& segments)
+{
+  Index num = 0;
+  for (const auto& s : segments) 
+    if (InsertSegment(s[0], s[1])) ++num;
+  return num;
+}
+
+
+
+//insert the segment from vert[v0] toward vert[v1] until the first vert on it
+//returns the vert where the inserted part ends (-1 if failed)
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::InsertSubSegment(Index v0, Index v1)
+{
+  const Vert& p0 = m_verts[v0];
+  const Vert& p1 = m_verts[v1];
+
+  // > 0 : vert[v] is on the left of the segment
+  auto Side = [&](Index v) {
+    const Vert& q = m_verts[v];
+    return Orient2d(p0.x, p0.y, p1.x, p1.y, q.x, q.y);
+  };
+
+  //vert[v] is on the segment ahead of v0 
+  auto OnSegment = [&](Index v) {
+    const Vert& q = m_verts[v];
+    return v == v1 || (Side(v) == 0 && 0 < ((double)q.x - p0.x) * ((double)p1.x - p0.x) + 
+                                           ((double)q.y - p0.y) * ((double)p1.y - p0.y));
+  };
+
+  //the spoke along the segment, or the face (v0, a, b) whose edge (a, b) 
+  //crosses it (a is on the right)
+  Index e = -1, spoke = -1, first = -1;
+  for (Index s : OutEdges(v0))
+  {
+    const Index a = m_edges[m_edges[s].next].vert;
+    const Index b = m_edges[m_edges[m_edges[s].next].next].vert;
+    if (first < 0) first = s;
+    if (OnSegment(a))
+    {
+      m_edges[s].SetConstrained(true);
+      if (m_edges[s].oppo != -1) m_edges[m_edges[s].oppo].SetConstrained(true);
+      return a;
+    }
+    if (Side(a) < 0 && 0 < Side(b))
+    {
+      spoke = s;
+      e = m_edges[s].next;
+      break;
+    }
+  }
+
+  //the segment along the incoming boundary edge b -> v0 (the prev of the 
+  //most counter clockwise spoke), which is not a spoke
+  if (e < 0)
+  {
+    if (first < 0) return -1;
+    const Index in = m_edges[m_edges[first].next].next;
+    if (m_edges[in].oppo != -1 || !OnSegment(m_edges[in].vert)) return -1;
+    m_edges[in].SetConstrained(true);
+    return m_edges[in].vert;
+  }
+
+  //step1 walk (nothing is changed until the walk succeeds)
+  //crossed edges go from right to left. rchain/lchain are the remaining 
+  //edges of the crossed faces on the right/left side
+  std::vector<Index>& crossed = m_seg_crossed;
+  std::vector<Index>& rchain  = m_seg_right;
+  std::vector<Index>& lchain  = m_seg_left;
+  crossed.clear();
+  rchain.clear();
+  lchain.clear();
+  rchain.push_back(spoke);
+  lchain.push_back(m_edges[e].next);
+
+  Index end = -1;
+  while (end < 0)
+  {
+    const Index o = m_edges[e].oppo;
+    if (o == -1 || m_edges[e].IsConstrained()) return -1;
+    crossed.push_back(e);
+
+    const Index rt = m_edges[o].next;  // r -> t
+    const Index tl = m_edges[rt].next; // t -> l
+    const Index t  = m_edges[tl].vert;
+    const double side = (t == v1) ? 0 : Side(t);
+    if (side == 0)
+    {
+      rchain.push_back(rt);
+      lchain.push_back(tl);
+      end = t;
+    }
+    else if (side < 0)
+    {
+      rchain.push_back(rt);
+      e = tl;
+    }
+    else
+    {
+      lchain.push_back(tl);
+      e = rt;
+    }
+  }
+
+  //step2 remove the crossed faces/edges
+  //each polygon vert starts one chain edge, which stays alive
+  for (Index c : rchain) m_verts[m_edges[c].vert].edge = c;
+  for (Index c : lchain) m_verts[m_edges[c].vert].edge = c;
+
+  FreeFace(m_edges[m_edges[crossed.back()].oppo].face);
+  for (Index c : crossed)
+  {
+    FreeFace(m_edges[c].face);
+    FreeEdge(m_edges[c].oppo);
+    FreeEdge(c);
+  }
+
+  //step3 the segment and the two pseudo polygons
+  const Index s  = NewEdge();
+  const Index st = NewEdge();
+  m_edges[s ] = Edge(v0 , st, -1, -1, true);
+  m_edges[st] = Edge(end, s , -1, -1, true);
+
+  //left polygon : v0 -> end -> (left verts) -> v0
+  std::reverse(lchain.begin(), lchain.end());
+  TriangulatePseudoPolygon(s , lchain);
+  TriangulatePseudoPolygon(st, rchain);
+
+  m_walk_face = m_edges[s].face;
+  return end;
+}
+
+
+
+//triangulate the polygon a -> b -> c1 -> ... -> a, where base is the half 
+//edge a -> b and chain[i] are the other half edges (b -> c1, ...)
+//all polygon verts should be on the left of the base edge
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::TriangulatePseudoPolygon(Index base, const std::vector<Index>& chain)
+{
+  //{base edge, first and last chain index} of sub polygons 
+  std::vector<std::array<Index, 3>>& jobs = m_seg_jobs;
+  jobs.clear();
+  jobs.push_back({ base, 0, (Index)chain.size() - 1 });
+
+  while (!jobs.empty())
+  {
+    const Index eb = jobs.back()[0], lo = jobs.back()[1], hi = jobs.back()[2];
+    jobs.pop_back();
+
+    const Index a = m_edges[eb].vert;
+    const Index b = m_edges[chain[lo]].vert;
+    const Vert& A = m_verts[a];
+    const Vert& B = m_verts[b];
+
+    //the vert whose circle (a,b,c) is empty of other polygon verts
+    Index ci = lo + 1;
+    for (Index i = lo + 2; i <= hi; ++i)
+    {
+      const Vert& C = m_verts[m_edges[chain[ci]].vert];
+      const Vert& P = m_verts[m_edges[chain[i ]].vert];
+      if (InCircle(A.x, A.y, B.x, B.y, C.x, C.y, P.x, P.y) > 0) ci = i;
+    }
+    const Index c = m_edges[chain[ci]].vert;
+
+    //triangle (a, b, c). edges b->c and c->a are new unless they are on the 
+    //chain, and their twins are the bases of the sub polygons
+    const Index f = NewFace();
+    Index e1 = chain[lo];
+    Index e2 = chain[hi];
+    if (lo + 1 < ci)
+    {
+      e1 = NewEdge();
+      const Index t = NewEdge();
+      m_edges[e1] = Edge(b, t , -1, -1);
+      m_edges[t ] = Edge(c, e1, -1, -1);
+      jobs.push_back({ t, lo, ci - 1 });
+    }
+    if (ci < hi)
+    {
+      e2 = NewEdge();
+      const Index t = NewEdge();
+      m_edges[e2] = Edge(c, t , -1, -1);
+      m_edges[t ] = Edge(a, e2, -1, -1);
+      jobs.push_back({ t, ci, hi });
+    }
+    m_edges[eb].SetNextFace(e1, f);
+    m_edges[e1].SetNextFace(e2, f);
+    m_edges[e2].SetNextFace(eb, f);
+    m_faces[f].edge = eb;
+    MarkDirty(eb);
+    MarkDirty(e1);
+    MarkDirty(e2);
+  }
+}
+
+
+/*-----------------------------
+* Delaunay refinement (Ruppert / Chew)
+*
+* segments : constrained edges and boundary edges (the domain boundary)
+* a segment is encroached if the apex of an adjacent face is inside its 
+* diametral circle (enough for a constrained Delaunay mesh), and it is 
+* split at its midpoint. encroached segments are processed first.
+*
+* bad faces (min angle < min_angle or area > max_area) are kept in a heap 
+* keyed by badness, and the worst one is popped. its circumcenter is 
+* located by the walk from the face and inserted by InsertVertexToFace, 
+* i.e. the same walk/flip path as AddNewVertex. if the new vert encroaches 
+* segments, it is removed and the segments are split instead.
+* a circumcenter outside of the mesh splits the boundary edge where the 
+* walk left the mesh. circumcenters that cannot be inserted at all are 
+* counted (GetRefineDropCount).
+* heap entries keep the verts of the face and are skipped if it changed.
+*
+* min_angle <= 20.7 deg terminates when input angles are not small (< 60 
+* deg between segments may need max_verts to stop).
+-----------------------------*/
+
+//badness of face f : > 1 if it is bad
+//B = 1 / (2 sin(min_angle)) bounds circumradius / shortest edge
+template <class Real, class IndexType>
+double DelaunayMeshT<Real, IndexType>::CalcBadness(Index f, double B, double max_area) const
+{
+  Index e0, e1, e2, v0, v1, v2;
+  GetFaceVsEs(f, e0, e1, e2, v0, v1, v2);
+  const Vert& a = m_verts[v0];
+  const Vert& b = m_verts[v1];
+  const Vert& c = m_verts[v2];
+
+  const double l2 = std::min(Vert::DistanceSq(a, b), 
+                    std::min(Vert::DistanceSq(b, c), Vert::DistanceSq(c, a)));
+  const double area = 0.5 * Orient2d(a.x, a.y, b.x, b.y, c.x, c.y);
+  if (area <= 0 || l2 <= 0) return 0;
+
+  //R = |ab||bc||ca| / (4 area)
+  const double R = sqrt(Vert::DistanceSq(a, b) * Vert::DistanceSq(b, c) * 
+                        Vert::DistanceSq(c, a)) / (4 * area);
+  double bad = R / sqrt(l2) / B;
+  if (max_area > 0) bad = std::max(bad, area / max_area);
+  return bad;
+}
+
+
+
+//true if edge e is a segment and the apex of one of its faces is inside 
+//of its diametral circle
+template <class Real, class IndexType>
+bool DelaunayMeshT<Real, IndexType>::IsEncroached(Index e) const
+{
+  const Edge& s = m_edges[e];
+  if (s.face < 0 || (s.oppo != -1 && !s.IsConstrained())) return false;
+
+  const Vert& a = m_verts[s.vert];
+  const Vert& b = m_verts[m_edges[s.next].vert];
+  auto Inside = [&](Index apex_edge) {
+    const Vert& c = m_verts[m_edges[apex_edge].vert];
+    return ((double)a.x - c.x) * ((double)b.x - c.x) + ((double)a.y - c.y) * ((double)b.y - c.y) < 0;
+  };
+  if (Inside(m_edges[s.next].next)) return true;
+  return s.oppo != -1 && Inside(m_edges[m_edges[s.oppo].next].next);
+}
+
+
+
+//insert a new vert at (x,y) on edge e (x,y should be on it)
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::SplitEdge(Index e, double x, double y)
+{
+  const Index  v    = NewVert(x, y);
+  const bool twin = m_edges[e].oppo != -1;
+
+  Index fs[2] = { NewFace(), twin ? NewFace() : -1 };
+  Index es[6] = { -1, -1, -1, -1, -1, -1 };
+  for (Index i = 0; i < (twin ? 6 : 3); ++i) es[i] = NewEdge();
+
+  InsertVertexToEdge(e, v, fs, es, m_flip_stack);
+  return v;
+}
+
+
+
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::Refine(double min_angle, double max_area, Index max_verts)
+{
+  const double PI = 3.14159265358979323846;
+  const double B  = 0.5 / sin(std::max(min_angle, 1.0) * PI / 180.0);
+
+  //{badness, {face, sorted verts}}
+  typedef std::pair<double, std::array<Index, 4>> BadFace;
+  std::priority_queue<BadFace> heap;
+  std::vector<Index> segs;
+
+  auto SortedVerts = [&](Index f) {
+    Index e0, e1, e2, v0, v1, v2;
+    GetFaceVsEs(f, e0, e1, e2, v0, v1, v2);
+    std::array<Index, 4> k = { f, v0, v1, v2 };
+    std::sort(k.begin() + 1, k.end());
+    return k;
+  };
+  auto PushFace = [&](Index f) {
+    const double bad = CalcBadness(f, B, max_area);
+    if (bad > 1) heap.push(BadFace(bad, SortedVerts(f)));
+  };
+  //faces around v (the star of a rejected vert after its removal)
+  auto PushFaces = [&](Index v) {
+    for (Index e : OutEdges(v)) PushFace(m_edges[e].face);
+  };
+  //faces around v, and segments that v may encroach or that end at v
+  auto PushStar = [&](Index v) {
+    for (Index e : OutEdges(v))
+    {
+      PushFace(m_edges[e].face);
+      segs.push_back(e);
+      segs.push_back(m_edges[e].next);
+      segs.push_back(m_edges[m_edges[e].next].next);
+    }
+  };
+
+  for (Index f : Faces()) PushFace(f);
+  for (Index e : Edges()) if (IsEncroached(e)) segs.push_back(e);
+
+  m_refine_drop_count = 0;
+  Index  num  = 0;
+  auto SplitSegment = [&](Index e) {
+    const Vert& a = m_verts[m_edges[e].vert];
+    const Vert& b = m_verts[m_edges[m_edges[e].next].vert];
+    const Index v = SplitEdge(e, 0.5 * ((double)a.x + b.x), 0.5 * ((double)a.y + b.y));
+    PushStar(v);
+    ++num;
+  };
+
+  std::vector<Index> encroached, ring;
+  while (max_verts < 0 || num < max_verts)
+  {
+    //step1 split encroached segments
+    if (!segs.empty())
+    {
+      const Index e = segs.back();
+      segs.pop_back();
+      if (IsEncroached(e)) SplitSegment(e);
+      continue;
+    }
+
+    //step2 the worst face 
+    //a face whose circumcenter is rejected is pushed again (the split 
+    //pushes the star of the new vert)
+    if (heap.empty()) break;
+    const std::array<Index, 4> k = heap.top().second;
+    heap.pop();
+    const Index f = k[0];
+    if (f >= (Index)m_faces.size() || m_faces[f].edge < 0 || SortedVerts(f) != k) continue;
+
+    Index e0, e1, e2, v0, v1, v2;
+    GetFaceVsEs(f, e0, e1, e2, v0, v1, v2);
+    double cx, cy, cr;
+    if (!Delaunay_CircumCircle(m_verts[v0], m_verts[v1], m_verts[v2], cx, cy, cr)) 
+    {
+      ++m_refine_drop_count;
+      continue;
+    }
+
+    //locate the circumcenter from f (with the fallback of a non convex mesh)
+    bool onEdge;
+    Index ce;
+    const Vert c((Real)cx, (Real)cy);
+    const Index fc = SearchFaceCotainPoint(c.x, c.y, f, onEdge, ce);
+    if (fc < 0)
+    {
+      //outside : split the boundary edge that the walk crossed
+      if (ce >= 0 && m_edges[ce].oppo == -1)
+      {
+        SplitSegment(ce);
+        if (m_faces[f].edge >= 0) PushFace(f);
+      }
+      else ++m_refine_drop_count;
+      continue;
+    }
+
+    if (onEdge)
+    {
+      //on a vert
+      if (ce < 0)
+      {
+        ++m_refine_drop_count;
+        continue;
+      }
+
+      //on a segment : split it instead
+      if (m_edges[ce].oppo == -1 || m_edges[ce].IsConstrained())
+      {
+        SplitSegment(ce);
+        if (m_faces[f].edge >= 0) PushFace(f);
+        continue;
+      }
+    }
+
+    Index v;
+    if (ce >= 0)
+    {
+      v = SplitEdge(ce, c.x, c.y);
+    }
+    else
+    {
+      v = NewVert(c.x, c.y);
+      Index fs[2], es[6];
+      for (auto& fi : fs) fi = NewFace();
+      for (auto& ei : es) ei = NewEdge();
+      InsertVertexToFace(fc, v, fs, es, m_flip_stack);
+    }
+
+    //reject the circumcenter if it encroaches segments, and split them
+    //(segments are never flipped, so their edges stay after the removal)
+    encroached.clear();
+    for (Index e : OutEdges(v))
+    {
+      const Index l = m_edges[e].next;
+      if (IsEncroached(l)) encroached.push_back(l);
+    }
+    if (!encroached.empty())
+    {
+      ring.clear();
+      for (Index e : OutEdges(v)) ring.push_back(m_edges[m_edges[e].next].vert);
+      RemoveVertex(v);
+      for (Index l : encroached) SplitSegment(l);
+      for (Index u : ring) PushFaces(u);
+      continue;
+    }
+
+    m_walk_face = m_edges[m_verts[v].edge].face;
+    PushStar(v);
+    ++num;
+  }
+  return num;
+}
+
+
+
+
+/*-----------------------------
+* Tombstone slots and compaction
+*
+* removed verts/faces/edges stay in their slots (see SlotRange) and their 
+* indices are pushed to the free lists. New* pops a free slot (or appends 
+* one), so that a remove/insert cycle does not grow the arrays and does 
+* not renumber other elements. 
+* RemoveFaces (and Init*) compacts the arrays, so it clears the lists.
+-----------------------------*/
+
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::NewVert(double x, double y)
+{
+  while (!m_free_verts.empty())
+  {
+    const Index v = m_free_verts.back();
+    m_free_verts.pop_back();
+    if (v < (Index)m_verts.size() && m_verts[v].edge < 0)
+    {
+      m_verts[v] = Vert((Real)x, (Real)y);
+      return v;
+    }
+  }
+  m_verts.push_back(Vert((Real)x, (Real)y));
+  return (Index)m_verts.size() - 1;
+}
+
+
+
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::NewFace()
+{
+  while (!m_free_faces.empty())
+  {
+    const Index f = m_free_faces.back();
+    m_free_faces.pop_back();
+    if (f < (Index)m_faces.size() && m_faces[f].edge < 0) return f;
+  }
+  m_faces.push_back(Face(-1));
+  return (Index)m_faces.size() - 1;
+}
+
+
+
+template <class Real, class IndexType>
+Index DelaunayMeshT<Real, IndexType>::NewEdge()
+{
+  while (!m_free_edges.empty())
+  {
+    const Index e = m_free_edges.back();
+    m_free_edges.pop_back();
+    if (e < (Index)m_edges.size() && m_edges[e].face < 0) return e;
+  }
+  m_edges.push_back(Edge(-1, -1, -1, -1));
+  return (Index)m_edges.size() - 1;
+}
+
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::FreeVert(Index v)
+{
+  m_verts[v].edge = -1;
+  m_free_verts.push_back(v);
+}
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::FreeFace(Index f)
+{
+  m_faces[f].edge = -1;
+  m_free_faces.push_back(f);
+}
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::FreeEdge(Index e)
+{
+  m_edges[e].face = -1;
+  m_free_edges.push_back(e);
+}
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::ClearFreeLists()
+{
+  m_free_verts.clear();
+  m_free_faces.clear();
+  m_free_edges.clear();
+}
+
+
+
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::Compact()
+{
+  std::vector<Index> new_vidx;
+  Compact(new_vidx);
+}
+
+
+
+//verts : live ones in hilbert order 
+//faces : counting sort by the smallest new index of their verts, so that 
+//        faces around a vert (and neighboring verts) are close in memory
+//edges : 3 * face + k, starting from m_faces[f].edge 
+template <class Real, class IndexType>
+void DelaunayMeshT<Real, IndexType>::Compact(std::vector<Index>& new_vidx)
+{
+  const Index V = (Index)m_verts.size();
+
+  std::vector<Index> order;
+  CalcHilbertOrder(order);
+
+  new_vidx.assign(V, -1);
+  Index nv = 0;
+  for (const Index v : order) if (m_verts[v].edge >= 0) new_vidx[v] = nv++;
+
+  //bucket[v + 1] : number of faces whose smallest vert is v
+  std::vector<Index> bucket(nv + 1, 0);
+  std::vector<Index> fkey(m_faces.size(), -1);
+  for (Index f : Faces())
+  {
+    Index e0, e1, e2, v0, v1, v2;
+    GetFaceVsEs(f, e0, e1, e2, v0, v1, v2);
+    fkey[f] = std::min(new_vidx[v0], std::min(new_vidx[v1], new_vidx[v2]));
+    ++bucket[fkey[f] + 1];
+  }
+  for (Index i = 0; i < nv; ++i) bucket[i + 1] += bucket[i];
+  const Index nf = bucket[nv];
+
+  std::vector<Index> new_fidx(m_faces.size(), -1);
+  for (Index f : Faces()) new_fidx[f] = bucket[fkey[f]]++;
+
+  std::vector<Index> new_eidx(m_edges.size(), -1);
+  for (Index f : Faces())
+  {
+    Index e = m_faces[f].edge;
+    for (Index k = 0; k < 3; ++k, e = m_edges[e].next) new_eidx[e] = 3 * new_fidx[f] + k;
+  }
+
+  std::vector<Vert> verts(nv, Vert(0, 0));
+  std::vector<Face> faces(nf);
+  std::vector<Edge> edges(3 * nf);
+
+#pragma omp parallel for
+  for (Index v = 0; v < V; ++v)
+  {
+    if (new_vidx[v] < 0) continue;
+    const Vert& src = m_verts[v];
+    verts[new_vidx[v]] = Vert(src.x, src.y, new_eidx[src.edge]);
+  }
+
+  const Index E = (Index)m_edges.size();
+#pragma omp parallel for
+  for (Index e = 0; e < E; ++e)
+  {
+    const Index ei = new_eidx[e];
+    if (ei < 0) continue;
+    const Edge& src = m_edges[e];
+    const Index oppo = (src.oppo < 0) ? -1 : new_eidx[src.oppo];
+    edges[ei] = Edge(new_vidx[src.vert], oppo, 3 * (ei / 3) + (ei % 3 + 1) % 3, ei / 3, 
+                       src.IsConstrained());
+  }
+  for (Index f = 0; f < nf; ++f) faces[f].edge = 3 * f;
+
+  m_verts.swap(verts);
+  m_faces.swap(faces);
+  m_edges.swap(edges);
+  ClearFreeLists();
+  MarkAllDirty();
+  m_walk_face = 0;
+}
+
+
+
+
+template <class IndexType>
+template <class Real>
+void CornerTableMeshT<IndexType>::Set(const DelaunayMeshT<Real, IndexType>& mesh)
+{
+  //live faces are packed (tombstones are skipped)
+  Index F = 0;
+  for (const auto& f : mesh.m_faces) if (!IsDeadSlot(f)) ++F;
+
+  m_origin = mesh.m_origin;
+  m_convex = mesh.m_convex;
+  m_x.resize(mesh.m_verts.size());
+  m_y.resize(mesh.m_verts.size());
+  m_vedge.assign(mesh.m_verts.size(), -1);
+  m_vert.resize(3 * F);
+  m_oppo.resize(3 * F);
+
+  //mesh.m_edges[i] is stored as corner edge_to_corner[i]
+  std::vector<Index> edge_to_corner(mesh.m_edges.size(), -1);
+  Index c = 0;
+  for (Index f : mesh.Faces())
+  {
+    Index e = mesh.m_faces[f].edge;
+    for (Index i = 0; i < 3; ++i, e = mesh.m_edges[e].next, ++c) 
+    {
+      edge_to_corner[e] = c;
+      m_vert[c] = mesh.m_edges[e].vert;
+    }
+  }
+
+  for (Index i = 0; i < (Index)mesh.m_edges.size(); ++i)
+  {
+    const Index c = edge_to_corner[i];
+    if (c < 0) continue;
+    const Index o = mesh.m_edges[i].oppo;
+    m_oppo[c] = (o < 0) ? -1 : edge_to_corner[o];
+  }
+
+  for (Index v = 0; v < (Index)mesh.m_verts.size(); ++v)
+  {
+    m_x[v] = mesh.m_verts[v].x;
+    m_y[v] = mesh.m_verts[v].y;
+    const Index e = mesh.m_verts[v].edge;
+    m_vedge[v] = (e < 0) ? -1 : edge_to_corner[e];
+  }
+}
+
+
+
+template <class IndexType>
+template <class Real>
+void CornerTableMeshT<IndexType>::Get(DelaunayMeshT<Real, IndexType>& mesh) const
+{
+  mesh.m_origin = m_origin;
+  mesh.m_verts.clear();
+  mesh.m_edges.resize(NumEdges());
+  mesh.m_faces.resize(NumFaces());
+
+  mesh.m_verts.reserve(NumVerts());
+  for (Index v = 0; v < NumVerts(); ++v) 
+    mesh.m_verts.push_back(HEVertT<Real, IndexType>((Real)m_x[v], (Real)m_y[v], m_vedge[v]));
+  for (Index e = 0; e < NumEdges(); ++e) mesh.m_edges[e] = GetEdge(e);
+  for (Index f = 0; f < NumFaces(); ++f) mesh.m_faces[f] = GetFace(f);
+
+  //same as InitByVsFs (the corner table has no tombstones)
+  mesh.m_walk_face = 0;
+  mesh.m_convex = m_convex;
+  mesh.m_insert_alloc_count = 0;
+  mesh.m_unmoved_count = 0;
+  mesh.m_refine_drop_count = 0;
+  mesh.ClearFreeLists();
+  mesh.MarkAllDirty();
+}
+
+
+
+template <class IndexType>
+bool CornerTableMeshT<IndexType>::GetOneRing(
+    const Index vidx, 
+    std::vector<Index>& vs, 
+    std::vector<Index>& es) const
+{
+  if (vidx < 0 || NumVerts() <= vidx) return false;
+  if (m_vedge[vidx] < 0) return false;
+
+  const Index piv_edge = m_vedge[vidx];
+
+  vs.clear();
+  es.clear();
+
+  Index e = piv_edge;
+  while (true)
+  {
+    //Check : vidx is on boundary
+    if (m_oppo[e] == -1)
+    {
+      es.clear();
+      return false;
+    }
+
+    es.push_back(e);
+    e = Next(m_oppo[e]);
+
+    if (e == piv_edge) break;
+  }
+
+  for (const auto& it : es) vs.push_back(m_vert[Next(it)]);
+
+  return true;
+}
+
+
+
+
+template <class IndexType>
+template <class Real>
+void VoronoiViewT<IndexType>::Set(const DelaunayMeshT<Real, IndexType>& mesh)
+{
+  const auto& verts = mesh.m_verts;
+  const auto& edges = mesh.m_edges;
+  const auto& faces = mesh.m_faces;
+  const Index V = (Index)verts.size();
+  const Index F = (Index)faces.size();
+
+  m_origin = mesh.m_origin;
+  m_x.resize(F);
+  m_y.resize(F);
+  m_begin.resize(V + 1);
+  m_open.resize(V);
+
+  //circumcenters, computed relative to the first vertex of each face
+#pragma omp parallel for
+  for (Index f = 0; f < F; ++f)
+  {
+    const Index e0 = faces[f].edge;
+    if (e0 < 0)
+    {
+      m_x[f] = m_y[f] = 0;
+      continue;
+    }
+    const Index e1 = edges[e0].next;
+    const Index e2 = edges[e1].next;
+    const HEVertT<Real, IndexType>& a = verts[edges[e0].vert];
+    const HEVertT<Real, IndexType>& b = verts[edges[e1].vert];
+    const HEVertT<Real, IndexType>& c = verts[edges[e2].vert];
+
+    const double bx = (double)b.x - a.x, by = (double)b.y - a.y;
+    const double cx = (double)c.x - a.x, cy = (double)c.y - a.y;
+    const double d  = 2.0 * (bx * cy - by * cx);
+    if (d == 0)
+    {
+      //degenerate face : use the centroid
+      m_x[f] = ((double)a.x + b.x + c.x) / 3.0;
+      m_y[f] = ((double)a.y + b.y + c.y) / 3.0;
+      continue;
+    }
+    const double bb = bx * bx + by * by;
+    const double cc = cx * cx + cy * cy;
+    m_x[f] = a.x + (cy * bb - by * cc) / d;
+    m_y[f] = a.y + (bx * cc - cx * bb) / d;
+  }
+
+  //cell sizes (one face per outgoing edge)
+#pragma omp parallel for
+  for (Index v = 0; v < V; ++v)
+  {
+    Index n = 0;
+    char open = 0;
+    for (Index e : mesh.OutEdges(v))
+    {
+      ++n;
+      if (edges[e].oppo == -1) open = 1;
+    }
+    m_begin[v + 1] = n;
+    m_open[v] = open;
+  }
+
+  m_begin[0] = 0;
+  for (Index v = 0; v < V; ++v) m_begin[v + 1] = m_begin[v + 1] + m_begin[v];
+  m_cell.resize(m_begin[V]);
+
+  //OutEdges is clockwise, so fill each range from its end
+#pragma omp parallel for
+  for (Index v = 0; v < V; ++v)
+  {
+    Index i = m_begin[v + 1];
+    for (Index e : mesh.OutEdges(v)) m_cell[--i] = edges[e].face;
+  }
+}
+
+
+
+template <class IndexType>
+void VoronoiViewT<IndexType>::CalcCellAreas(std::vector<double>& area) const
+{
+  const Index V = NumCells();
+  area.resize(V);
+
+#pragma omp parallel for
+  for (Index v = 0; v < V; ++v)
+  {
+    area[v] = 0;
+    if (m_open[v] || CellSize(v) < 3) continue;
+
+    //shoelace, relative to the first voronoi vertex
+    const Index b = m_begin[v], n = CellSize(v);
+    const double ox = m_x[m_cell[b]], oy = m_y[m_cell[b]];
+    double a = 0;
+    for (Index i = 1; i + 1 < n; ++i)
+    {
+      const Index p = m_cell[b + i], q = m_cell[b + i + 1];
+      a += (m_x[p] - ox) * (m_y[q] - oy) - (m_y[p] - oy) * (m_x[q] - ox);
+    }
+    area[v] = 0.5 * a;
+  }
+}
+
+
+
+//float and double meshes with uint32_t and int64_t indices (see DelaunayMeshT)
+template class delaunay::DelaunayMeshT<double>;
+template class delaunay::DelaunayMeshT<float >;
+template class delaunay::DelaunayMeshT<double, std::int64_t>;
+template class delaunay::DelaunayMeshT<float , std::int64_t>;
+
+template class delaunay::CornerTableMeshT<std::uint32_t>;
+template class delaunay::CornerTableMeshT<std::int64_t >;
+template class delaunay::VoronoiViewT<std::uint32_t>;
+template class delaunay::VoronoiViewT<std::int64_t >;
+
+template void CornerTableMesh::Set(const DelaunayMesh & mesh);
+template void CornerTableMesh::Set(const DelaunayMeshF& mesh);
+template void CornerTableMesh::Get(DelaunayMesh & mesh) const;
+template void CornerTableMesh::Get(DelaunayMeshF& mesh) const;
+template void VoronoiView::Set(const DelaunayMesh & mesh);
+template void VoronoiView::Set(const DelaunayMeshF& mesh);
+template void CornerTableMeshT<std::int64_t>::Set(const DelaunayMesh64 & mesh);
+template void CornerTableMeshT<std::int64_t>::Set(const DelaunayMeshF64& mesh);
+template void CornerTableMeshT<std::int64_t>::Get(DelaunayMesh64 & mesh) const;
+template void CornerTableMeshT<std::int64_t>::Get(DelaunayMeshF64& mesh) const;
+template void VoronoiViewT<std::int64_t>::Set(const DelaunayMesh64 & mesh);
+template void VoronoiViewT<std::int64_t>::Set(const DelaunayMeshF64& mesh);
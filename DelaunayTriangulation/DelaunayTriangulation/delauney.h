@@ -3,51 +3,167 @@
 #include <vector>
 #include <array>
 #include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
 
 namespace delaunay 
 {
 
-class HEVert 
+//order in which InitMesh inserts the input points
+// INPUT   : caller's order 
+// RANDOM  : random shuffle 
+// HILBERT : sorted along the Hilbert curve over the bounding box
+// BRIO    : biased randomized insertion order, Hilbert sorted in each round
+enum class InsertOrder 
+{
+  INPUT, 
+  RANDOM, 
+  HILBERT, 
+  BRIO
+};
+
+//construction algorithm of InitMesh
+// INCREMENTAL          : point insertion + edge flip (points outside of the 
+//                        current mesh extend its convex hull)
+// DIVIDE_AND_CONQUER   : Guibas-Stolfi divide and conquer
+// PARALLEL_INCREMENTAL : INCREMENTAL by OpenMP threads, each insertion locks 
+//                        the faces touched by its edge flips (retry on conflict)
+enum class BuildEngine 
+{
+  INCREMENTAL,
+  DIVIDE_AND_CONQUER,
+  PARALLEL_INCREMENTAL
+};
+
+//target of MoveVertsToVolonoiCenter / LloydRelaxation
+// ONE_RING_AVERAGE : average of the one ring verts 
+// VORONOI_CENTROID : area centroid of the voronoi cell, the polygon of the 
+//                    circumcenters of the faces around the vertex 
+//                    (optionally clipped by a convex polygon)
+enum class RelaxCenter 
+{
+  ONE_RING_AVERAGE,
+  VORONOI_CENTROID
+};
+
+/*-----------------------------
+* Index of a vert / face / edge
+*
+* Index (signed 64 bit, -1 : none) is used in all computations and 
+* interfaces. HEVert / HEEdge / HEFace store it as IndexT<IndexType>
+*   uint32_t : default. all 32 bits are used (up to 2^32 - 2 elements), 
+*              -1 is stored as the sentinel 0xffffffff
+*   int64_t  : meshes beyond 2^32 half edges, twice the index memory
+* HEEdge::vert is a FlaggedIndexT (the top bit is the constrained flag), 
+* so sizeof(HEEdge) is 16 bytes (32 bytes with int64_t)
+-----------------------------*/
+
+typedef std::int64_t Index;
+
+template <class IndexType>
+class IndexT
+{
+public:
+  IndexT(Index i = -1) : m_i((IndexType)i) {}
+
+  //the sentinel wraps to 0 (uint32_t), so that it is read as -1
+  operator Index() const { return (Index)(IndexType)(m_i + 1) - 1; }
+
+private:
+  IndexType m_i;
+};
+
+
+
+//IndexT with a flag in the top bit (HEEdgeT::vert keeps the constrained 
+//flag, so that a half edge stays 4 indices). vert indices are far below 
+//2^31 (2^63) because there are more than 3 half edges per vert. 
+//assigning an index keeps the flag
+template <class IndexType>
+class FlaggedIndexT
+{
+  typedef typename std::make_unsigned<IndexType>::type UIndex;
+  static constexpr UIndex FLAG = (UIndex)1 << (8 * sizeof(UIndex) - 1);
+  static constexpr UIndex MASK = FLAG - 1;
+
+public:
+  FlaggedIndexT(Index i = -1, bool flag = false) : m_i(((UIndex)i & MASK) | (flag ? FLAG : 0)) {}
+
+  FlaggedIndexT& operator=(Index i) 
+  { 
+    m_i = ((UIndex)i & MASK) | (m_i & FLAG); 
+    return *this; 
+  }
+
+  //the sentinel MASK wraps to 0, so that it is read as -1
+  operator Index() const { return (Index)((m_i + 1) & MASK) - 1; }
+
+  bool Flag() const { return (m_i & FLAG) != 0; }
+  void SetFlag(bool flag) { m_i = flag ? (m_i | FLAG) : (m_i & MASK); }
+
+private:
+  UIndex m_i;
+};
+
+
+
+//vertex coordinates are stored as Real (float or double) relative to the 
+//origin of the mesh (DelaunayMeshT::m_origin). computations on them are 
+//done in double (float -> double is exact, so predicates stay exact)
+template <class Real, class IndexType = std::uint32_t>
+class HEVertT 
 {
 public:
-  double x, y;
-  int   edge;//oĂedge idx
+  Real x, y;
+  IndexT<IndexType> edge;//oĂedge idx
   
-  HEVert(double x, double y, int _edge = -1) : x(x), y(y), edge(_edge) {}
+  HEVertT(Real x, Real y, Index _edge = -1) : x(x), y(y), edge(_edge) {}
 
-  HEVert(const HEVert& src) 
+  HEVertT(const HEVertT& src) 
   {
     Set(src);
   }
 
-  HEVert& operator=(const HEVert& src) 
+  HEVertT& operator=(const HEVertT& src) 
   { 
     Set(src); 
     return *this; 
   }
 
-  void Set(const HEVert& src) 
+  void Set(const HEVertT& src) 
   {
     x = src.x;
     y = src.y;
     edge = src.edge;
   }
   
-  double NormSq()const{ return x*x + y*y;}
+  double NormSq()const{ return (double)x*x + (double)y*y;}
 
-  static double Distance(const HEVert& p, const HEVert& q) {
-    return sqrt( (p.x - q.x) * (p.x - q.x) + (p.y - q.y) * (p.y - q.y) );
+  static double Distance(const HEVertT& p, const HEVertT& q) {
+    return sqrt( DistanceSq(p, q) );
+  }
+
+  static double DistanceSq(const HEVertT& p, const HEVertT& q) {
+    const double dx = (double)p.x - q.x, dy = (double)p.y - q.y;
+    return dx * dx + dy * dy;
   }
   
 };
 
-class HEFace 
+typedef HEVertT<double> HEVert;
+typedef HEVertT<float > HEVertF;
+
+template <class IndexType = std::uint32_t>
+class HEFaceT 
 {
   public:
-    int edge; // ͂edge
-    HEFace(int _edge = -1) : edge(_edge) {}
+    IndexT<IndexType> edge; // ͂edge
+    HEFaceT(Index _edge = -1) : edge(_edge) {}
 };
 
+typedef HEFaceT<> HEFace;
+
 
 /*-----------------------------
 * User half edge data structure 
@@ -66,24 +182,31 @@ class HEFace
 //oppo = -1 Ȃ炻̎Op`̓oE_
 -----------------------------*/
 
-class HEEdge 
+template <class IndexType = std::uint32_t>
+class HEEdgeT 
 {
 public:
-  int vert; 
-  int oppo;
-  int next;
-  int face;
-  HEEdge(int _vert = -1, int _oppo = -1, int _next = -1, int _face = -1) : 
-    vert(_vert), oppo(_oppo), next(_next), face(_face) {}
+  FlaggedIndexT<IndexType> vert; // flag : constrained
+  IndexT<IndexType> oppo;
+  IndexT<IndexType> next;
+  IndexT<IndexType> face;
+  HEEdgeT(Index _vert = -1, Index _oppo = -1, Index _next = -1, Index _face = -1, 
+          bool _constrained = false) : 
+    vert(_vert, _constrained), oppo(_oppo), next(_next), face(_face) {}
+
+  //segment edge, never flipped (both half edges are set, a boundary 
+  //segment is a single half edge)
+  bool IsConstrained() const { return vert.Flag(); }
+  void SetConstrained(bool c) { vert.SetFlag(c); }
 
 
-  void SetNextFace(int _next, int _face)
+  void SetNextFace(Index _next, Index _face)
   {
     next = _next;
     face = _face;
   }
 
-  void SetVertNext(int _vert, int _next)
+  void SetVertNext(Index _vert, Index _next)
   {
     vert = _vert;
     next = _next;
@@ -91,50 +214,636 @@ public:
 
   void Trace() {
     std::cout << "-------------\n";
-    std::cout << "vert: " << vert << " oppo: " << oppo << " next: " << next << " face: " << face << "\n";
+    std::cout << "vert: " << (Index)vert << " oppo: " << (Index)oppo << " next: " << (Index)next 
+              << " face: " << (Index)face << "\n";
+  }
+
+
+};
+
+typedef HEEdgeT<> HEEdge;
+
+
+/*-----------------------------
+* Outgoing half edges of a vertex (no allocation)
+*
+*   for (Index e : mesh.OutEdges(vidx)) { ... }
+*
+* edges are visited clockwise (e -> e.oppo.next) starting at vert.edge.
+* for a boundary vertex the circulation starts at the most counter clockwise
+* edge, so every outgoing edge is visited once and the last one has oppo = -1
+* (if a vertex is pinched by two boundary fans, only the fan of vert.edge)
+-----------------------------*/
+
+template <class Edge>
+class OutEdgeIterator
+{
+public:
+  OutEdgeIterator(const std::vector<Edge>& edges, Index e) : 
+    m_edges(&edges), m_e(e), m_start(e) {}
+
+  Index  operator* () const { return m_e; }
+  bool operator!=(const OutEdgeIterator& it) const { return m_e != it.m_e; }
+
+  OutEdgeIterator& operator++()
+  {
+    const Index o = (*m_edges)[m_e].oppo;
+    m_e = (o == -1) ? -1 : (Index)(*m_edges)[o].next;
+    if (m_e == m_start) m_e = -1;
+    return *this;
+  }
+
+private:
+  const std::vector<Edge>* m_edges;
+  Index m_e;
+  Index m_start;
+};
+
+
+template <class Edge>
+class OutEdgeRange
+{
+public:
+  OutEdgeRange(const std::vector<Edge>& edges, Index e) : m_edges(edges), m_first(e)
+  {
+    if (e < 0) return;
+
+    //rewind counter clockwise until the boundary (or one round)
+    Index f = e;
+    while (true)
+    {
+      const Index o = edges[edges[edges[f].next].next].oppo;
+      if (o == -1) 
+      {
+        m_first = f;
+        break;
+      }
+      f = o;
+      if (f == e) break;
+    }
+  }
+
+  OutEdgeIterator<Edge> begin() const { return OutEdgeIterator<Edge>(m_edges, m_first); }
+  OutEdgeIterator<Edge> end  () const { return OutEdgeIterator<Edge>(m_edges, -1); }
+
+private:
+  const std::vector<Edge>& m_edges;
+  Index m_first;
+};
+
+
+
+/*-----------------------------
+* Result of DelaunayMesh::Validate / ValidateDirty
+*
+* every live half edge is tested for its links (next/oppo/face/vert), 
+* each face once for orientation, and each interior edge once by incircle 
+* (constrained edges are skipped)
+-----------------------------*/
+
+class ValidationReport
+{
+public:
+  Index num_edges;         // checked half edges
+  Index num_topology;      // half edges with broken links
+  Index num_inverted;      // faces that are not counter clockwise 
+  Index num_non_delaunay;  // edges whose opposite vertex is in the circumcircle
+  std::vector<Index> bad_edges; // half edges with any error (sorted)
+
+  ValidationReport() : num_edges(0), num_topology(0), num_inverted(0), num_non_delaunay(0) {}
+
+  bool IsValid() const { return num_topology == 0 && num_inverted == 0 && num_non_delaunay == 0; }
+};
+
+
+
+/*-----------------------------
+* Live slots of m_verts / m_faces / m_edges 
+*
+*   for (Index f : mesh.Faces()) { ... }
+*
+* a removed element stays in its slot as a tombstone until the slot is 
+* reused by an insertion or Compact() is called
+*   vert : edge = -1 (isolated verts, e.g. skipped duplicates, too)
+*   face : edge = -1
+*   edge : face = -1
+-----------------------------*/
+
+template <class Real, class IndexType>
+inline bool IsDeadSlot(const HEVertT<Real, IndexType>& v) { return v.edge < 0; }
+template <class IndexType>
+inline bool IsDeadSlot(const HEFaceT<IndexType>& f) { return f.edge < 0; }
+template <class IndexType>
+inline bool IsDeadSlot(const HEEdgeT<IndexType>& e) { return e.face < 0; }
+
+template <class T>
+class SlotIterator
+{
+public:
+  SlotIterator(const std::vector<T>& slots, Index i) : m_slots(&slots), m_i(i) { Skip(); }
+
+  Index  operator* () const { return m_i; }
+  bool operator!=(const SlotIterator& it) const { return m_i != it.m_i; }
+
+  SlotIterator& operator++()
+  {
+    ++m_i;
+    Skip();
+    return *this;
   }
 
+private:
+  const std::vector<T>* m_slots;
+  Index m_i;
 
+  void Skip() 
+  { 
+    while (m_i < (Index)m_slots->size() && IsDeadSlot((*m_slots)[m_i])) ++m_i; 
+  }
 };
 
 
-class DelaunayMesh
+template <class T>
+class SlotRange
 {
 public:
-  std::vector<HEVert> m_verts;
-  std::vector<HEFace> m_faces;
-  std::vector<HEEdge> m_edges;
+  SlotRange(const std::vector<T>& slots) : m_slots(slots) {}
+  SlotIterator<T> begin() const { return SlotIterator<T>(m_slots, 0); }
+  SlotIterator<T> end  () const { return SlotIterator<T>(m_slots, (Index)m_slots.size()); }
+
+private:
+  const std::vector<T>& m_slots;
+};
 
-  DelaunayMesh(){}
-  void InitMesh(std::vector<std::array<double,2>>& points);
+
+
+/*-----------------------------
+* Delaunay mesh with Real (float or double) vertex coordinates
+*
+*   DelaunayMesh  : double
+*   DelaunayMeshF : float, half the vertex memory (for visualization data)
+*   DelaunayMesh64 / DelaunayMeshF64 : int64_t indices for meshes beyond 
+*                   2^32 half edges (the default uint32_t allows 2^32 - 2)
+*
+* coordinates are stored relative to m_origin, the center of the input 
+* bounding box snapped so that (point - m_origin) is exact in double, 
+* i.e. a double mesh keeps the input points exactly. all geometric 
+* computations promote coordinates to double, so the predicates are exact 
+* on the stored values and a float mesh is also a valid triangulation 
+* (of the points rounded to float)
+-----------------------------*/
+
+template <class IndexType> class CornerTableMeshT;
+
+template <class Real, class IndexType = std::uint32_t>
+class DelaunayMeshT
+{
+  //CornerTableMeshT::Get resets the private state
+  template <class> friend class CornerTableMeshT;
+
+public:
+  typedef HEVertT<Real, IndexType> Vert;
+  typedef HEFaceT<IndexType>       Face;
+  typedef HEEdgeT<IndexType>       Edge;
+
+  std::vector<Vert>   m_verts;  // relative to m_origin
+  std::vector<Face>   m_faces;
+  std::vector<Edge>   m_edges;
+  std::array<double,2> m_origin;
+
+  DelaunayMeshT() : m_origin({{ 0, 0 }}), m_walk_face(0), m_walk_seed(1), m_insert_alloc_count(0), 
+                    m_unmoved_count(0), m_refine_drop_count(0), m_defer_vert_edges(false), m_convex(true), m_track_dirty(false), m_dirty_all(true) {}
+
+  //the boundary of the mesh is the convex hull of the points (there is no 
+  //bounding triangle). incremental engines store points[i] as m_verts[i] 
+  //(edge = -1 if skipped : duplicated, or all points are collinear)
+  //m_origin is set from the bounding box of points
+  void InitMesh(std::vector<std::array<double,2>>& points, 
+                InsertOrder order  = InsertOrder::BRIO,
+                BuildEngine engine = BuildEngine::INCREMENTAL);
   
+  //insert points into the current mesh (the mesh is not cleared)
+  //the batch is sorted in hilbert order, and each walk starts from the face
+  //where the previous point was inserted (the first one from face[hint], 
+  //or the last located face if hint < 0). cost depends on the batch only
+  //a point on an edge splits it, and a point outside of the mesh extends 
+  //the convex hull (only while the boundary is convex, see m_convex)
+  //on a non convex mesh, a point the walk cannot reach (across a concave 
+  //part of the boundary) is located by a linear scan of the faces
+  //vidx[i] : vert index of points[i] (-1 : outside of a non convex mesh, or 
+  //duplicated). returns the number of inserted points
+  Index  InsertPoints(const std::vector<std::array<double,2>>& points, Index hint = -1);
+  Index  InsertPoints(const std::vector<std::array<double,2>>& points, Index hint, 
+                      std::vector<Index>& vidx);
+
+  //true if all edges are (constrained) Delaunay, same as 
+  //Validate().num_non_delaunay == 0
   bool CheckAllEdge();
 
+  //check the whole mesh in parallel (nothing is printed)
+  ValidationReport Validate() const;
+
+  //dirty edge tracking : insertions, flips, moves and removals record the 
+  //edges they touch, and ValidateDirty checks only them (their faces and 
+  //twins) and clears the record. the first call after SetDirtyTracking or 
+  //a rebuild (Init*, Compact, RemoveFaces, parallel modes, Jacobi moves) 
+  //falls back to Validate()
+  void SetDirtyTracking(bool on);
+  ValidationReport ValidateDirty();
+
   double CalcAverateEdgeLength();
   void   RemoveBoundingFacesWithLongEdge(double r);
-  void   MoveVertsToVolonoiCenter();
+  //Jacobi smoothing : all centers are computed from the current positions
+  //(in parallel), then verts are moved. boundary verts and endpoints of 
+  //constrained edges are fixed
+  //clip : convex polygon (ccw) that clips voronoi cells (not used if empty)
+  void   MoveVertsToVolonoiCenter(
+            RelaxCenter center = RelaxCenter::ONE_RING_AVERAGE,
+            const std::vector<std::array<double,2>>& clip = {});
+
+  //move interior verts to their centers (same as MoveVertsToVolonoiCenter) 
+  //and repair the mesh by local flips instead of rebuilding it
+  //boundary and constrained verts are fixed. returns the number of 
+  //re-inserted verts (see also GetUnmovedVertCount)
+  Index  LloydRelaxation(
+            int iterations = 1, 
+            RelaxCenter center = RelaxCenter::ONE_RING_AVERAGE,
+            const std::vector<std::array<double,2>>& clip = {});
+
+  //CVT energy (sum of the integral of |x - vert|^2 over the voronoi cell of 
+  //each interior vert). grad[i] = 2 area[i] (vert[i] - centroid of cell i)
+  //boundary and constrained verts have grad = 0, area = 0
+  double CalcCVTEnergy(const std::vector<std::array<double,2>>& clip,
+                       std::vector<std::array<double,2>>& grad,
+                       std::vector<double>& area) const;
+
+  //minimize CalcCVTEnergy by L-BFGS (the mesh is repaired by flips after 
+  //each trial step). returns the number of iterations
+  int    OptimizeCVT(int max_iterations, 
+                     const std::vector<std::array<double,2>>& clip = {},
+                     int    history  = 7,
+                     double grad_tol = 1e-12);
+
+  //build half edges from an indexed face list (faces should be ccw)
+  //opposite half edges are matched by bucketing (min,max) vertex pairs 
+  //(two counting sorts, linear time for any valence)
+  //m_origin is set from the bounding box of verts
+  void InitByVsFs(const std::vector<std::array<double,2>> &verts, 
+                  const std::vector<std::array<Index,3>> &faces);
+
+  //Lawson flips until every edge (except constrained ones) is Delaunay
+  //the mesh should be a valid triangulation (e.g. given by InitByVsFs)
+  //parallel : OpenMP threads flip in rounds, each flip locks the edges of 
+  //its quad
+  //returns the number of flips
+  Index  MakeDelaunay(bool parallel = false);
+
+  //remove vert[vidx] and retriangulate its star (Delaunay ear clipping)
+  //a boundary vert removes its faces (the pocket left in a convex mesh is 
+  //triangulated, so it stays convex). freed slots become tombstones 
+  //(see SlotRange) and are reused by later insertions
+  //returns false for an endpoint of a constrained edge
+  bool RemoveVertex(Index vidx);
+
+  //insert segment vert[v0]-vert[v1] as constrained edges (constrained 
+  //Delaunay). crossed faces are retriangulated and a vert on the segment 
+  //splits it. constrained edges are never flipped by later insertions
+  //returns false if the segment leaves the mesh or crosses another 
+  //constrained edge (sub segments before that point stay inserted)
+  //InsertSegments returns the number of inserted segments
+  bool InsertSegment(Index v0, Index v1);
+  Index  InsertSegments(const std::vector<std::array<Index,2>>& segments);
+
+  //quality refinement (Ruppert / Chew) : insert circumcenters of faces with 
+  //min angle < min_angle [deg] or area > max_area (not used if <= 0), worst 
+  //first, and split segments (constrained and boundary edges) encroached 
+  //by them. max_verts bounds the new verts (< 0 : no limit, should be set 
+  //if segments meet at small angles). returns the number of new verts
+  //(see also GetRefineDropCount)
+  Index  Refine(double min_angle = 20.0, double max_area = 0, Index max_verts = -1);
+
+  //live verts/faces/edges (tombstones are skipped)
+  SlotRange<Vert>   Verts() const { return SlotRange<Vert>  (m_verts); }
+  SlotRange<Face>   Faces() const { return SlotRange<Face>  (m_faces); }
+  SlotRange<Edge>   Edges() const { return SlotRange<Edge>  (m_edges); }
+
+  //drop tombstones (and isolated verts) and renumber live elements 
+  //verts in hilbert order, faces by their smallest vert, edges = 3 * face + k
+  //new_vidx[v] : new index of vert v (-1 if dropped)
+  void Compact();
+  void Compact(std::vector<Index>& new_vidx);
+
+  //position of vert[vidx] in the input coordinates
+  std::array<double,2> GetVertPos(Index vidx) const 
+  { 
+    return {{ m_origin[0] + m_verts[vidx].x, m_origin[1] + m_verts[vidx].y }}; 
+  }
+
+  //outgoing half edges of vert[vidx] (see OutEdgeRange)
+  OutEdgeRange<Edge> OutEdges(Index vidx) const { return OutEdgeRange<Edge>(m_edges, m_verts[vidx].edge); }
+
+  //number of insertions (InsertVertex) that reallocated the face/edge 
+  //arrays or the flip stack during the last InitMesh (0 if the capacity 
+  //reserved by InitMesh was enough, see bench/bench_mesh.cpp)
+  int GetInsertAllocCount() const { return m_insert_alloc_count; }
+
+  //number of verts that the last LloydRelaxation / OptimizeCVT (its trial 
+  //steps included) could not move, because the target was outside of the 
+  //mesh, on a vert or a segment. they keep their position
+  Index GetUnmovedVertCount() const { return m_unmoved_count; }
+
+  //number of circumcenters that the last Refine could not insert 
+  //(degenerate faces, on a vert, or outside with no boundary edge to split)
+  Index GetRefineDropCount() const { return m_refine_drop_count; }
 private:
-  int SearchFaceCotainPoint(double x, double y);
-  void AddNewVertex(double x, double y);
+  //start face of the next point location walk (the last located face)
+  Index      m_walk_face;
+  unsigned m_walk_seed;
+
+  //edge stack of InsertVertexToFace, kept to reuse its capacity
+  std::vector<Index> m_flip_stack;
+  int              m_insert_alloc_count;
+  Index            m_unmoved_count;
+  Index            m_refine_drop_count;
+
+  //set by the parallel modes : InsertVertexToFace / FlipEdge do not set the 
+  //edge of the verts around (threads share them), a serial pass does
+  bool             m_defer_vert_edges;
+
+  //work buffers of RemoveVertex
+  std::vector<Index>    m_rm_spokes, m_rm_faces, m_rm_edges, m_rm_poly;
+  std::vector<double> m_rm_key;
+
+  //the boundary is convex (the convex hull). false after faces are removed
+  //(RemoveBoundingFacesWithLongEdge, RemoveVertex on the boundary) or the 
+  //mesh is given by InitByVsFs. points outside of the mesh are inserted 
+  //only if it is true
+  bool             m_convex;
+  std::vector<Index> m_hull_chain;
+
+  //see SetDirtyTracking. nothing is recorded while m_dirty_all is set
+  //m_dirty_mark[e] : 1 if e is in m_dirty_edges (2 : used by ValidateDirty)
+  bool              m_track_dirty;
+  bool              m_dirty_all;
+  std::vector<Index>  m_dirty_edges, m_dirty_check;
+  std::vector<char> m_dirty_mark;
+
+  void MarkDirty(Index e) 
+  {
+    if (!m_track_dirty || m_dirty_all) return;
+    if ((Index)m_dirty_mark.size() <= e) m_dirty_mark.resize(m_edges.capacity(), 0);
+    if (m_dirty_mark[e]) return;
+    m_dirty_mark[e] = 1;
+    m_dirty_edges.push_back(e);
+  }
+  void MarkAllDirty()
+  {
+    for (const Index e : m_dirty_edges) m_dirty_mark[e] = 0;
+    m_dirty_edges.clear();
+    m_dirty_all = true;
+  }
+
+  //error flags of half edge h (VALID_*), h should be live
+  int  ValidateEdge(Index h) const;
+  //check half edges hs[0..n) (all edges if hs is null)
+  ValidationReport ValidateEdges(const Index* hs, Index n) const;
+
+  //work buffers of InsertSegment
+  std::vector<Index>                m_seg_crossed, m_seg_left, m_seg_right;
+  std::vector<std::array<Index, 3>> m_seg_jobs;
+
+  //tombstone slots to be reused 
+  std::vector<Index> m_free_verts, m_free_faces, m_free_edges;
+
+  Index  NewVert(double x, double y);
+  Index  NewFace();
+  Index  NewEdge();
+  void FreeVert(Index v);
+  void FreeFace(Index f);
+  void FreeEdge(Index e);
+  void ClearFreeLists();
+
+  //walk from face[hint] (or m_walk_face if hint < 0) toward (x,y) 
+  //returns -1 if (x,y) is outside of the mesh or not strictly inside a face
+  Index SearchFaceCotainPoint(double x, double y, Index hint = -1);
+  //same as above, but a point on an edge / outside is also reported 
+  //(see WalkToPoint for edge)
+  //a walk that leaves a non convex mesh (m_convex = false) or does not 
+  //terminate falls back to SearchFaceCotainPointLinear
+  Index SearchFaceCotainPoint(double x, double y, Index hint, bool& onEdge, Index& edge);
+  Index SearchFaceCotainPointLinear(double x, double y);
+  Index SearchFaceCotainPointLinear(double x, double y, bool& onEdge, Index& edge) const;
+  Index WalkToPoint(const Vert& p, Index f, unsigned& seed, Index max_step, 
+                    bool& onEdge, Index& edge) const;
+  bool AddNewVertex(double x, double y);
+  bool InsertVertex(Index vidx);
+
+  //split face[f0idx] by vert[v3idx] and flip edges to recover Delaunay 
+  //new faces fs[0], fs[1] and edges es[0] ... es[5] should be allocated 
+  //flip_stack is a work buffer (its capacity is reused between calls)
+  void InsertVertexToFace(Index f0idx, Index v3idx, const Index fs[2], const Index es[6], 
+                          std::vector<Index>& flip_stack);
+  //split edge e0idx by vert[v4idx] (fs/es : same as InsertVertexToFace)
+  void InsertVertexToEdge(Index e0idx, Index v4idx, const Index fs[2], const Index es[6], 
+                          std::vector<Index>& flip_stack);
+  //connect vert[vidx] outside of the convex mesh to the boundary edges it 
+  //sees (e : one of them) and flip to recover Delaunay
+  void InsertVertexOutside(Index e, Index vidx, std::vector<Index>& flip_stack);
+  void FlipLinkEdges(std::vector<Index>& Q);
+  bool FlipIfNotDelaunay(Index e0idx);
+  void FlipEdge(Index e0idx);
+
+  //Lawson flips from the edges in Q (Q is empty after the call)
+  //returns the number of flips
+  Index  RepairByFlips(std::vector<Index>& Q);
+  void CalcVoronoiCenters(RelaxCenter center, 
+                          const std::vector<std::array<double,2>>& clip,
+                          std::vector<std::array<double,2>>& centers);
+  bool CalcVoronoiCell(Index vidx, 
+                       const std::vector<std::array<double,2>>& clip,
+                       std::vector<std::array<double,2>>& cell,
+                       std::vector<std::array<double,2>>& tmp) const;
+  void CalcHilbertOrder(std::vector<Index>& order) const;
+  Index  MoveVertsWithRepair(const std::vector<std::array<double,2>>& pos, 
+                             const std::vector<Index>& order);
+  bool MoveVertexInStar(Index vidx, double x, double y, std::vector<Index>& Q);
+  bool ReinsertVertex  (Index vidx, double x, double y, std::vector<Index>& Q);
+  Index  DetachVertex    (Index vidx, std::vector<Index>& Q);
+
+  //vert[vidx] is an endpoint of a constrained edge (incoming boundary 
+  //edges included, they have no twin among the spokes)
+  bool IsConstrainedEndpoint(Index vidx) const;
+  void RemoveBoundaryFan(Index vidx);
+  bool FillBoundaryPocket(Index K);
+
+  Index  InsertSubSegment(Index v0, Index v1);
+  void TriangulatePseudoPolygon(Index base, const std::vector<Index>& chain);
+
+  double CalcBadness(Index f, double B, double max_area) const;
+  bool   IsEncroached(Index e) const;
+  Index    SplitEdge(Index e, double x, double y);
+
+  //insert m_verts[verts[k]] in parallel (edge of a skipped vertex stays -1)
+  void InsertVertsParallel(const std::vector<Index>& verts);
+
+  //set m_origin from the bounding box of points (see the class comment)
+  void SetOrigin(const std::vector<std::array<double,2>>& points);
+  //verts[i] = points[i] - m_origin (rounded to Real, edge = -1)
+  void ToLocal(const std::vector<std::array<double,2>>& points, 
+               std::vector<Vert>& verts) const;
+  //local[i] = points[i] - m_origin (not rounded, e.g. clip polygons)
+  void ToLocal(const std::vector<std::array<double,2>>& points, 
+               std::vector<std::array<double,2>>& local) const;
+
+  bool InitSeedTriangle(std::vector<Index>& order);
+  void RemoveFaces(const std::vector<char>& face_dead, const std::vector<char>& vert_dead);
+
+  //verts/points are relative to m_origin (verts are moved to m_verts)
+  void InitByVsFsLocal(std::vector<Vert> &verts, 
+                       const std::vector<std::array<Index,3>> &faces);
+  void InitMeshDivideAndConquer(const std::vector<Vert>& points);
+
+
+  //get (v0,v1,v2) and (e0,e1,e2) of face[fidx]
+  void GetFaceVsEs(Index fidx, Index &e0, Index &e1, Index &e2, 
+                               Index &v0, Index &v1, Index &v2) const;
+
+
+  
+
+};
 
+typedef DelaunayMeshT<double> DelaunayMesh;
+typedef DelaunayMeshT<float > DelaunayMeshF;
+typedef DelaunayMeshT<double, std::int64_t> DelaunayMesh64;
+typedef DelaunayMeshT<float , std::int64_t> DelaunayMeshF64;
+
+//member functions are defined in delauney.cpp
+extern template class DelaunayMeshT<double>;
+extern template class DelaunayMeshT<float >;
+extern template class DelaunayMeshT<double, std::int64_t>;
+extern template class DelaunayMeshT<float , std::int64_t>;
+
+
+
+/*-----------------------------
+* Compact storage of a triangle mesh (corner table)
+* 
+* face f owns three consecutive half edges 3f, 3f+1, 3f+2 so that 
+*   next(e) = 3*(e/3) + (e+1)%3
+*   face(e) = e/3
+* only vert(e) and oppo(e) are stored (8 bytes per half edge for uint32_t), 
+* vertex coordinates are stored as separated x/y arrays (double, relative 
+* to m_origin as in the mesh). 
+* the accessors give the same values as HEVert/HEEdge/HEFace (the 
+* constrained flag is kept in the top bit of vert, as HEEdge::vert)
+-----------------------------*/
+
+template <class IndexType = std::uint32_t>
+class CornerTableMeshT
+{
+public:
+  std::vector<double> m_x, m_y;
+  std::array<double,2> m_origin;
+  std::vector<IndexT<IndexType>> m_vedge;  // outgoing half edge of each vertex
+  std::vector<FlaggedIndexT<IndexType>> m_vert; // HEEdge::vert (flag : constrained)
+  std::vector<IndexT<IndexType>> m_oppo;   // HEEdge::oppo
+  bool m_convex;                           // DelaunayMeshT::m_convex
+
+  CornerTableMeshT() : m_origin({{ 0, 0 }}), m_convex(true) {}
+
+  //copy from / to the half edge data structure (float or double mesh)
+  //Get replaces the whole mesh (its tombstones, free lists and the walk 
+  //state are reset as by InitByVsFs)
+  template <class Real> void Set(const DelaunayMeshT<Real, IndexType>& mesh);
+  template <class Real> void Get(DelaunayMeshT<Real, IndexType>& mesh) const;
+
+  Index NumVerts() const { return (Index)m_x.size(); }
+  Index NumFaces() const { return (Index)m_vert.size() / 3; }
+  Index NumEdges() const { return (Index)m_vert.size(); }
+
+  Index Vert(Index e) const { return m_vert[e]; }
+  Index Oppo(Index e) const { return m_oppo[e]; }
+  bool  IsConstrained(Index e) const { return m_vert[e].Flag(); }
+  Index Next(Index e) const { return (e % 3 == 2) ? e - 2 : e + 1; }
+  Index Face(Index e) const { return e / 3; }
+
+  HEVertT<double, IndexType> GetVert(Index v) const 
+  { 
+    return HEVertT<double, IndexType>(m_x[v], m_y[v], m_vedge[v]); 
+  }
+  HEEdgeT<IndexType> GetEdge(Index e) const 
+  { 
+    return HEEdgeT<IndexType>(Vert(e), Oppo(e), Next(e), Face(e), IsConstrained(e)); 
+  }
+  HEFaceT<IndexType> GetFace(Index f) const { return HEFaceT<IndexType>(3 * f); }
 
   //get (v0,v1,v2) and (e0,e1,e2) of face[fidx]
-  void GetFaceVsEs(int fidx, int &e0, int &e1, int &e2, 
-                             int &v0, int &v1, int &v2) const;
+  void GetFaceVsEs(Index fidx, Index &e0, Index &e1, Index &e2, 
+                               Index &v0, Index &v1, Index &v2) const
+  {
+    e0 = 3 * fidx; 
+    e1 = e0 + 1; 
+    e2 = e0 + 2;
+    v0 = m_vert[e0]; 
+    v1 = m_vert[e1]; 
+    v2 = m_vert[e2];
+  }
 
   //if vidx is on boundary, this function returns false 
   //otherwise this returns true and set vs/es
-  bool GetOneRing(const int vidx, std::vector<int> &vs, std::vector<int> &es);
+  bool GetOneRing(const Index vidx, std::vector<Index> &vs, std::vector<Index> &es) const;
+};
+
+typedef CornerTableMeshT<> CornerTableMesh;
 
-  void InitByVsFs(std::vector<std::array<double,2>> &verts, 
-                  std::vector<std::array<int   ,3>> &faces);
 
 
-  
 
-};
 
+/*-----------------------------
+* Voronoi diagram (dual of DelaunayMesh)
+*
+*   VoronoiView vv;
+*   vv.Set(mesh);
+*   for (Index i = vv.CellBegin(v); i < vv.CellEnd(v); ++i) 
+*     x = vv.m_x[vv.m_cell[i]], y = vv.m_y[vv.m_cell[i]]
+*
+* voronoi vertices : circumcenters of all faces, indexed by face slot 
+*                    (tombstone slots are left as 0), relative to m_origin
+* voronoi cells    : CSR ranges of face indices, counter clockwise
+* a cell of a boundary vert is unbounded (m_open[v] = 1), 
+* its range is the chain of faces from one boundary edge to the other.
+* Set() is two linear passes without per cell allocation, 
+* buffers are reused when Set() is called again.
+* (call Compact() first for large meshes, the passes are memory bound)
+-----------------------------*/
+
+template <class IndexType = std::uint32_t>
+class VoronoiViewT
+{
+public:
+  std::vector<double> m_x, m_y;  // circumcenter of face[f]
+  std::array<double,2> m_origin; // same as the mesh
+  std::vector<IndexT<IndexType>> m_begin; // cell of vert[v] is m_cell[m_begin[v] .. m_begin[v+1])
+  std::vector<IndexT<IndexType>> m_cell;  // face indices
+  std::vector<char>   m_open;    // 1 : unbounded cell (boundary vert)
+
+  VoronoiViewT() : m_origin({{ 0, 0 }}) {}
+
+  template <class Real> void Set(const DelaunayMeshT<Real, IndexType>& mesh);
+
+  Index  NumCells () const { return (Index)m_open.size(); }
+  Index  CellBegin(Index v) const { return m_begin[v]; }
+  Index  CellEnd  (Index v) const { return m_begin[v + 1]; }
+  Index  CellSize (Index v) const { return m_begin[v + 1] - m_begin[v]; }
+  bool IsOpen   (Index v) const { return m_open[v] != 0; }
+
+  //area of each cell (0 for unbounded cells and removed verts)
+  void CalcCellAreas(std::vector<double>& area) const;
+};
 
+typedef VoronoiViewT<> VoronoiView;
 
 }
 
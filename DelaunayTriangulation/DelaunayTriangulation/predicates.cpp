@@ -0,0 +1,420 @@
+#include "pch.h"
+#include "predicates.h"
+#include <cmath>
+#include <algorithm>
+
+
+using namespace delaunay;
+
+
+
+//error bounds of the double evaluation (Shewchuk)
+static const double PRED_EPS        = 1.1102230246251565e-16; // 2^-53
+static const double PRED_SPLITTER   = 134217729.0;            // 2^27 + 1
+static const double PRED_CCW_BOUND  = (3.0  + 16.0 * PRED_EPS) * PRED_EPS;
+static const double PRED_ICC_BOUND  = (10.0 + 96.0 * PRED_EPS) * PRED_EPS;
+
+//bounds of the adaptive stages (B : exact on the rounded differences, 
+//C : B corrected by the round-off tails of the differences)
+static const double PRED_RESULT_BOUND = (3.0  + 8.0   * PRED_EPS) * PRED_EPS;
+static const double PRED_CCW_BOUND_B  = (2.0  + 12.0  * PRED_EPS) * PRED_EPS;
+static const double PRED_CCW_BOUND_C  = (9.0  + 64.0  * PRED_EPS) * PRED_EPS * PRED_EPS;
+static const double PRED_ICC_BOUND_B  = (4.0  + 48.0  * PRED_EPS) * PRED_EPS;
+static const double PRED_ICC_BOUND_C  = (44.0 + 576.0 * PRED_EPS) * PRED_EPS * PRED_EPS;
+
+
+
+/*-----------------------------
+* floating point expansion
+* a number is represented by the sum of non-overlapping doubles
+* e[0] + e[1] + ... (increasing magnitude, e[n-1] has the sign of the sum)
+-----------------------------*/
+
+//a + b = x + y exactly (x = fl(a+b))
+static inline void Pred_TwoSum(const double a, const double b, double& x, double& y)
+{
+  x = a + b;
+  const double bv = x - a;
+  const double av = x - bv;
+  y = (a - av) + (b - bv);
+}
+
+//a + b = x + y exactly, |a| >= |b|
+static inline void Pred_FastTwoSum(const double a, const double b, double& x, double& y)
+{
+  x = a + b;
+  y = b - (x - a);
+}
+
+//a - b = x + y exactly
+static inline void Pred_TwoDiff(const double a, const double b, double& x, double& y)
+{
+  x = a - b;
+  const double bv = a - x;
+  const double av = x + bv;
+  y = (a - av) + (bv - b);
+}
+
+static inline void Pred_Split(const double a, double& hi, double& lo)
+{
+  const double c = PRED_SPLITTER * a;
+  hi = c - (c - a);
+  lo = a - hi;
+}
+
+//a * b = x + y exactly
+static inline void Pred_TwoProduct(const double a, const double b, double& x, double& y)
+{
+  x = a * b;
+  double ahi, alo, bhi, blo;
+  Pred_Split(a, ahi, alo);
+  Pred_Split(b, bhi, blo);
+  const double err1 = x - (ahi * bhi);
+  const double err2 = err1 - (alo * bhi);
+  const double err3 = err2 - (ahi * blo);
+  y = (alo * blo) - err3;
+}
+
+
+
+//h = e + f (zero components are eliminated)
+//h should have elen + flen elements
+static int Pred_ExpansionSum(
+  const int elen, const double* e,
+  const int flen, const double* f,
+  double* h)
+{
+  int ei = 0, fi = 0, hi = 0;
+  double Q, Qnew, hh;
+
+  //merge e and f in order of magnitude
+  auto Next = [&]() -> double {
+    if (fi >= flen || (ei < elen && (f[fi] > e[ei]) == (f[fi] > -e[ei]))) return e[ei++];
+    return f[fi++];
+  };
+
+  Q = Next();
+  while (ei < elen || fi < flen)
+  {
+    Pred_TwoSum(Q, Next(), Qnew, hh);
+    Q = Qnew;
+    if (hh != 0.0) h[hi++] = hh;
+  }
+  if (Q != 0.0 || hi == 0) h[hi++] = Q;
+  return hi;
+}
+
+
+
+//h = e * b (zero components are eliminated)
+//h should have 2 * elen elements
+static int Pred_ScaleExpansion(
+  const int elen, const double* e,
+  const double b,
+  double* h)
+{
+  int hi = 0;
+  double Q, hh, p1, p0, sum;
+
+  Pred_TwoProduct(e[0], b, Q, hh);
+  if (hh != 0.0) h[hi++] = hh;
+
+  for (int i = 1; i < elen; ++i)
+  {
+    Pred_TwoProduct(e[i], b, p1, p0);
+    Pred_TwoSum(Q, p0, sum, hh);
+    if (hh != 0.0) h[hi++] = hh;
+    Pred_FastTwoSum(p1, sum, Q, hh);
+    if (hh != 0.0) h[hi++] = hh;
+  }
+  if (Q != 0.0 || hi == 0) h[hi++] = Q;
+  return hi;
+}
+
+
+
+//h = e * f, elen <= 16
+//h should have 2 * elen * flen elements
+static int Pred_ExpansionProduct(
+  const int elen, const double* e,
+  const int flen, const double* f,
+  double* h)
+{
+  double scaled[32];
+  double tmp[512];
+
+  int hlen = Pred_ScaleExpansion(elen, e, f[0], h);
+  for (int i = 1; i < flen; ++i)
+  {
+    const int slen = Pred_ScaleExpansion(elen, e, f[i], scaled);
+    const int tlen = Pred_ExpansionSum(hlen, h, slen, scaled, tmp);
+    std::copy(tmp, tmp + tlen, h);
+    hlen = tlen;
+  }
+  return hlen;
+}
+
+
+
+//approximate value of an expansion
+static double Pred_Estimate(const int elen, const double* e)
+{
+  double sum = e[0];
+  for (int i = 1; i < elen; ++i) sum += e[i];
+  return sum;
+}
+
+
+
+//h = a * b - c * d exactly, for doubles a, b, c, d
+//h should have 4 elements
+static int Pred_TwoTwoDiff(const double a, const double b, const double c, const double d, double* h)
+{
+  double ab[2], cd[2];
+  Pred_TwoProduct(a, b, ab[1], ab[0]);
+  Pred_TwoProduct(c, d, cd[1], cd[0]);
+  cd[0] = -cd[0];
+  cd[1] = -cd[1];
+  return Pred_ExpansionSum(2, ab, 2, cd, h);
+}
+
+
+
+//h = (x^2 + y^2) * e exactly, elen <= 4
+//h should have 32 elements
+static int Pred_LiftExpansion(const int elen, const double* e, const double x, const double y, double* h)
+{
+  double xe[8], xxe[16], ye[8], yye[16];
+  const int xlen  = Pred_ScaleExpansion(elen, e, x, xe);
+  const int xxlen = Pred_ScaleExpansion(xlen, xe, x, xxe);
+  const int ylen  = Pred_ScaleExpansion(elen, e, y, ye);
+  const int yylen = Pred_ScaleExpansion(ylen, ye, y, yye);
+  return Pred_ExpansionSum(xxlen, xxe, yylen, yye, h);
+}
+
+
+
+//h = a * b + sign * c * d, for two-component expansions a, b, c, d
+//h should have 16 elements
+static int Pred_ProductSum(
+  const double* a, const double* b,
+  const double* c, const double* d,
+  const double sign,
+  double* h)
+{
+  double ab[8], cd[8];
+  const int ablen = Pred_ExpansionProduct(2, a, 2, b, ab);
+  const int cdlen = Pred_ExpansionProduct(2, c, 2, d, cd);
+  for (int i = 0; i < cdlen; ++i) cd[i] *= sign;
+  return Pred_ExpansionSum(ablen, ab, cdlen, cd, h);
+}
+
+
+
+static double Pred_Orient2dExact(
+  double ax, double ay,
+  double bx, double by,
+  double cx, double cy)
+{
+  double acx[2], acy[2], bcx[2], bcy[2];
+  Pred_TwoDiff(ax, cx, acx[1], acx[0]);
+  Pred_TwoDiff(ay, cy, acy[1], acy[0]);
+  Pred_TwoDiff(bx, cx, bcx[1], bcx[0]);
+  Pred_TwoDiff(by, cy, bcy[1], bcy[0]);
+
+  double det[16];
+  const int n = Pred_ProductSum(acx, bcy, acy, bcx, -1.0, det);
+  return det[n - 1];
+}
+
+
+
+static double Pred_InCircleExact(
+  double ax, double ay,
+  double bx, double by,
+  double cx, double cy,
+  double dx, double dy)
+{
+  double adx[2], ady[2], bdx[2], bdy[2], cdx[2], cdy[2];
+  Pred_TwoDiff(ax, dx, adx[1], adx[0]);
+  Pred_TwoDiff(ay, dy, ady[1], ady[0]);
+  Pred_TwoDiff(bx, dx, bdx[1], bdx[0]);
+  Pred_TwoDiff(by, dy, bdy[1], bdy[0]);
+  Pred_TwoDiff(cx, dx, cdx[1], cdx[0]);
+  Pred_TwoDiff(cy, dy, cdy[1], cdy[0]);
+
+  double lift[16], det[16];
+  double ta[512], tb[512], tc[512], tab[1024], sum[1536];
+
+  int llen = Pred_ProductSum(adx, adx, ady, ady, 1.0, lift);
+  int dlen = Pred_ProductSum(bdx, cdy, cdx, bdy, -1.0, det);
+  const int talen = Pred_ExpansionProduct(llen, lift, dlen, det, ta);
+
+  llen = Pred_ProductSum(bdx, bdx, bdy, bdy, 1.0, lift);
+  dlen = Pred_ProductSum(cdx, ady, adx, cdy, -1.0, det);
+  const int tblen = Pred_ExpansionProduct(llen, lift, dlen, det, tb);
+
+  llen = Pred_ProductSum(cdx, cdx, cdy, cdy, 1.0, lift);
+  dlen = Pred_ProductSum(adx, bdy, bdx, ady, -1.0, det);
+  const int tclen = Pred_ExpansionProduct(llen, lift, dlen, det, tc);
+
+  const int tablen = Pred_ExpansionSum(talen, ta, tblen, tb, tab);
+  const int n      = Pred_ExpansionSum(tablen, tab, tclen, tc, sum);
+  return sum[n - 1];
+}
+
+
+
+/*-----------------------------
+* adaptive stages (Shewchuk) between the static filter and the exact 
+* evaluation. B : the determinant of the rounded differences is computed 
+* exactly (a few products), C : it is corrected by the first order terms of 
+* the round-off tails of the differences. the exact evaluation runs only 
+* when C cannot decide the sign (nearly degenerate inputs), so its big 
+* buffers are not touched on the usual path
+-----------------------------*/
+
+static double Pred_Orient2dAdapt(
+  double ax, double ay,
+  double bx, double by,
+  double cx, double cy,
+  double detsum)
+{
+  const double acx = ax - cx, bcx = bx - cx;
+  const double acy = ay - cy, bcy = by - cy;
+
+  //stage B
+  double B[4];
+  const int blen = Pred_TwoTwoDiff(acx, bcy, acy, bcx, B);
+  double det = Pred_Estimate(blen, B);
+  double errbound = PRED_CCW_BOUND_B * detsum;
+  if (det >= errbound || -det >= errbound) return det;
+
+  //stage C
+  double acxtail, acytail, bcxtail, bcytail, tmp;
+  Pred_TwoDiff(ax, cx, tmp, acxtail);
+  Pred_TwoDiff(bx, cx, tmp, bcxtail);
+  Pred_TwoDiff(ay, cy, tmp, acytail);
+  Pred_TwoDiff(by, cy, tmp, bcytail);
+  if (acxtail == 0.0 && acytail == 0.0 && bcxtail == 0.0 && bcytail == 0.0) return det;
+
+  errbound = PRED_CCW_BOUND_C * detsum + PRED_RESULT_BOUND * std::abs(det);
+  det += (acx * bcytail + bcy * acxtail) - (acy * bcxtail + bcx * acytail);
+  if (det >= errbound || -det >= errbound) return det;
+
+  return Pred_Orient2dExact(ax, ay, bx, by, cx, cy);
+}
+
+
+
+static double Pred_InCircleAdapt(
+  double ax, double ay,
+  double bx, double by,
+  double cx, double cy,
+  double dx, double dy,
+  double permanent)
+{
+  const double adx = ax - dx, ady = ay - dy;
+  const double bdx = bx - dx, bdy = by - dy;
+  const double cdx = cx - dx, cdy = cy - dy;
+
+  //stage B
+  double bc[4], ca[4], ab[4];
+  double adet[32], bdet[32], cdet[32], abdet[64], fin[96];
+  const int bclen = Pred_TwoTwoDiff(bdx, cdy, cdx, bdy, bc);
+  const int calen = Pred_TwoTwoDiff(cdx, ady, adx, cdy, ca);
+  const int ablen = Pred_TwoTwoDiff(adx, bdy, bdx, ady, ab);
+  const int alen  = Pred_LiftExpansion(bclen, bc, adx, ady, adet);
+  const int blen  = Pred_LiftExpansion(calen, ca, bdx, bdy, bdet);
+  const int clen  = Pred_LiftExpansion(ablen, ab, cdx, cdy, cdet);
+  const int ablen2 = Pred_ExpansionSum(alen, adet, blen, bdet, abdet);
+  const int finlen = Pred_ExpansionSum(ablen2, abdet, clen, cdet, fin);
+
+  double det = Pred_Estimate(finlen, fin);
+  double errbound = PRED_ICC_BOUND_B * permanent;
+  if (det >= errbound || -det >= errbound) return det;
+
+  //stage C
+  double adxtail, adytail, bdxtail, bdytail, cdxtail, cdytail, tmp;
+  Pred_TwoDiff(ax, dx, tmp, adxtail);
+  Pred_TwoDiff(ay, dy, tmp, adytail);
+  Pred_TwoDiff(bx, dx, tmp, bdxtail);
+  Pred_TwoDiff(by, dy, tmp, bdytail);
+  Pred_TwoDiff(cx, dx, tmp, cdxtail);
+  Pred_TwoDiff(cy, dy, tmp, cdytail);
+  if (adxtail == 0.0 && bdxtail == 0.0 && cdxtail == 0.0 && 
+      adytail == 0.0 && bdytail == 0.0 && cdytail == 0.0) return det;
+
+  errbound = PRED_ICC_BOUND_C * permanent + PRED_RESULT_BOUND * std::abs(det);
+  det += ((adx * adx + ady * ady) * ((bdx * cdytail + cdy * bdxtail) - (bdy * cdxtail + cdx * bdytail))
+          + 2.0 * (adx * adxtail + ady * adytail) * (bdx * cdy - bdy * cdx))
+       + ((bdx * bdx + bdy * bdy) * ((cdx * adytail + ady * cdxtail) - (cdy * adxtail + adx * cdytail))
+          + 2.0 * (bdx * bdxtail + bdy * bdytail) * (cdx * ady - cdy * adx))
+       + ((cdx * cdx + cdy * cdy) * ((adx * bdytail + bdy * adxtail) - (ady * bdxtail + bdx * adytail))
+          + 2.0 * (cdx * cdxtail + cdy * cdytail) * (adx * bdy - ady * bdx));
+  if (det >= errbound || -det >= errbound) return det;
+
+  return Pred_InCircleExact(ax, ay, bx, by, cx, cy, dx, dy);
+}
+
+
+
+double delaunay::Orient2d(
+  double ax, double ay,
+  double bx, double by,
+  double cx, double cy)
+{
+  const double detleft  = (ax - cx) * (by - cy);
+  const double detright = (ay - cy) * (bx - cx);
+  const double det      = detleft - detright;
+
+  double detsum;
+  if (detleft > 0.0)
+  {
+    if (detright <= 0.0) return det;
+    detsum = detleft + detright;
+  }
+  else if (detleft < 0.0)
+  {
+    if (detright >= 0.0) return det;
+    detsum = -detleft - detright;
+  }
+  else
+  {
+    return det;
+  }
+
+  if (std::abs(det) >= PRED_CCW_BOUND * detsum) return det;
+  return Pred_Orient2dAdapt(ax, ay, bx, by, cx, cy, detsum);
+}
+
+
+
+double delaunay::InCircle(
+  double ax, double ay,
+  double bx, double by,
+  double cx, double cy,
+  double dx, double dy)
+{
+  const double adx = ax - dx, ady = ay - dy;
+  const double bdx = bx - dx, bdy = by - dy;
+  const double cdx = cx - dx, cdy = cy - dy;
+
+  const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+  const double cdxady = cdx * ady, adxcdy = adx * cdy;
+  const double adxbdy = adx * bdy, bdxady = bdx * ady;
+  const double alift  = adx * adx + ady * ady;
+  const double blift  = bdx * bdx + bdy * bdy;
+  const double clift  = cdx * cdx + cdy * cdy;
+
+  const double det = alift * (bdxcdy - cdxbdy)
+                   + blift * (cdxady - adxcdy)
+                   + clift * (adxbdy - bdxady);
+
+  const double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift
+                         + (std::abs(cdxady) + std::abs(adxcdy)) * blift
+                         + (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+
+  if (std::abs(det) > PRED_ICC_BOUND * permanent) return det;
+  return Pred_InCircleAdapt(ax, ay, bx, by, cx, cy, dx, dy, permanent);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+/*-----------------------------
+* Geometric predicates (orient2d / incircle)
+*
+* The determinant is first evaluated in double with a static error bound
+* (Shewchuk, "Adaptive Precision Floating-Point Arithmetic and Fast Robust
+* Geometric Predicates"). Only when the result is smaller than the bound,
+* it is refined adaptively (the exact determinant of the rounded 
+* differences, then a correction by their round-off tails), and it is 
+* recomputed exactly by floating point expansions as the last resort.
+* The sign of the returned value is always exact.
+-----------------------------*/
+
+namespace delaunay
+{
+
+// > 0 : (a, b, c) is counter clockwise
+// < 0 : clockwise
+// = 0 : collinear
+double Orient2d(
+  double ax, double ay,
+  double bx, double by,
+  double cx, double cy);
+
+// > 0 : d is inside of the circle through counter clockwise (a, b, c)
+// < 0 : outside
+// = 0 : on the circle
+double InCircle(
+  double ax, double ay,
+  double bx, double by,
+  double cx, double cy,
+  double dx, double dy);
+
+}
@@ -0,0 +1,79 @@
+/*-----------------------------
+* Memory / throughput of the mesh variants (Real x IndexType)
+*
+* builds the same random points with DelaunayMesh, DelaunayMeshF, 
+* DelaunayMesh64 and DelaunayMeshF64, and prints the size of the elements,
+* the bytes per vertex of the vert/face/edge arrays and the build time
+* (the best of a few runs). allocs is GetInsertAllocCount : InitMesh 
+* reserves the arrays, so the insertions should never reallocate (returns 
+* 1 otherwise)
+*
+*   bench_mesh [num_points = 1000000] [runs = 3]
+*
+*   g++ -O2 -fopenmp -std=c++17 bench_mesh.cpp 
+*       ../DelaunayTriangulation/delauney.cpp ../DelaunayTriangulation/predicates.cpp
+*   cl /O2 /openmp /std:c++17 /EHsc bench_mesh.cpp 
+*       ../DelaunayTriangulation/delauney.cpp ../DelaunayTriangulation/predicates.cpp
+-----------------------------*/
+
+#include "../DelaunayTriangulation/delauney.h"
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+using namespace delaunay;
+
+typedef std::array<double, 2> Pt;
+
+
+
+template <class Mesh>
+static bool Bench(const char* name, const std::vector<Pt>& points, int runs)
+{
+  double best = HUGE_VAL;
+  int allocs = 0;
+  Mesh mesh;
+  for (int r = 0; r < runs; ++r)
+  {
+    std::vector<Pt> ps = points;
+    mesh = Mesh();
+    const auto t0 = std::chrono::steady_clock::now();
+    mesh.InitMesh(ps);
+    const auto t1 = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    allocs = std::max(allocs, mesh.GetInsertAllocCount());
+  }
+
+  const double V = (double)mesh.m_verts.size();
+  const double bytes = (double)mesh.m_verts.size() * sizeof(typename Mesh::Vert) 
+                     + (double)mesh.m_faces.size() * sizeof(typename Mesh::Face) 
+                     + (double)mesh.m_edges.size() * sizeof(typename Mesh::Edge);
+  std::printf("%-16s %4zu %4zu %4zu %10.1f %10.3f %10.2f %6d\n", name, 
+              sizeof(typename Mesh::Vert), sizeof(typename Mesh::Face), sizeof(typename Mesh::Edge), 
+              bytes / V, best, V / best * 1e-6, allocs);
+  return allocs == 0;
+}
+
+
+
+int main(int argc, char** argv)
+{
+  const int N    = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const int runs = argc > 2 ? std::atoi(argv[2]) : 3;
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> U(0, 1);
+  std::vector<Pt> points(N);
+  for (auto& p : points) p = {{ U(rng), U(rng) }};
+
+  std::printf("%d points, best of %d runs\n", N, runs);
+  std::printf("%-16s %4s %4s %4s %10s %10s %10s %6s\n", "mesh", "vert", "face", "edge", "bytes/vert", "build [s]", "Mpts/s", "allocs");
+  bool ok = true;
+  ok = Bench<DelaunayMesh   >("DelaunayMesh"   , points, runs) && ok;
+  ok = Bench<DelaunayMeshF  >("DelaunayMeshF"  , points, runs) && ok;
+  ok = Bench<DelaunayMesh64 >("DelaunayMesh64" , points, runs) && ok;
+  ok = Bench<DelaunayMeshF64>("DelaunayMeshF64", points, runs) && ok;
+  return ok ? 0 : 1;
+}
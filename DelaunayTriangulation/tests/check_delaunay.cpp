@@ -0,0 +1,734 @@
+/*-----------------------------
+* Consistency checks of DelaunayMesh 
+*
+* prints one line per check and returns 1 if any of them failed
+*
+*   g++ -O2 -fopenmp -std=c++17 check_delaunay.cpp 
+*       ../DelaunayTriangulation/delauney.cpp ../DelaunayTriangulation/predicates.cpp
+*   cl /O2 /openmp /std:c++17 /EHsc check_delaunay.cpp 
+*       ../DelaunayTriangulation/delauney.cpp ../DelaunayTriangulation/predicates.cpp
+-----------------------------*/
+
+#include "../DelaunayTriangulation/delauney.h"
+#include "../DelaunayTriangulation/predicates.h"
+#include <cstdio>
+#include <random>
+#include <set>
+#include <map>
+#include <algorithm>
+
+using namespace delaunay;
+
+typedef std::array<double, 2> Pt;
+typedef std::array<Pt, 3>     Tri;
+
+static int g_failed = 0;
+
+static void Check(bool ok, const char* name)
+{
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+  if (!ok) ++g_failed;
+}
+
+
+
+static std::vector<Pt> RandomPoints(int n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> U(0, 1);
+  std::vector<Pt> ps(n);
+  for (auto& p : ps) p = {{ U(rng), U(rng) }};
+  return ps;
+}
+
+
+
+//faces as ccw triples of input coordinates, starting at the smallest one
+//(the Delaunay triangulation of points in general position is unique)
+template <class Mesh>
+static std::set<Tri> Triangles(const Mesh& mesh)
+{
+  std::set<Tri> tris;
+  for (Index f : mesh.Faces())
+  {
+    const auto& e0 = mesh.m_edges[mesh.m_faces[f].edge];
+    const auto& e1 = mesh.m_edges[e0.next];
+    const auto& e2 = mesh.m_edges[e1.next];
+    Tri t = {{ mesh.GetVertPos(e0.vert), mesh.GetVertPos(e1.vert), mesh.GetVertPos(e2.vert) }};
+    std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+    tris.insert(t);
+  }
+  return tris;
+}
+
+
+
+//smallest angle [deg] of the live faces
+template <class Mesh>
+static double MinAngle(const Mesh& mesh)
+{
+  const double PI = 3.14159265358979323846;
+  double min_angle = 180;
+  for (Index f : mesh.Faces())
+  {
+    const auto& e0 = mesh.m_edges[mesh.m_faces[f].edge];
+    const auto& e1 = mesh.m_edges[e0.next];
+    const auto& e2 = mesh.m_edges[e1.next];
+    const Pt p[3] = { mesh.GetVertPos(e0.vert), mesh.GetVertPos(e1.vert), mesh.GetVertPos(e2.vert) };
+    for (int k = 0; k < 3; ++k)
+    {
+      const Pt& a = p[k];
+      const Pt& b = p[(k + 1) % 3];
+      const Pt& c = p[(k + 2) % 3];
+      const double ux = b[0] - a[0], uy = b[1] - a[1];
+      const double vx = c[0] - a[0], vy = c[1] - a[1];
+      const double angle = std::atan2(std::fabs(ux * vy - uy * vx), ux * vx + uy * vy);
+      min_angle = std::min(min_angle, angle * 180 / PI);
+    }
+  }
+  return min_angle;
+}
+
+
+
+template <class Mesh>
+static bool IsBoundaryVert(const Mesh& mesh, Index v)
+{
+  for (Index e : mesh.OutEdges(v)) if (mesh.m_edges[e].oppo == -1) return true;
+  return false;
+}
+
+
+
+//flip edge e0 of a convex quad by hand (same as DelaunayMesh::FlipEdge), 
+//nothing is recorded for ValidateDirty. returns false if not convex
+template <class Mesh>
+static bool FlipByHand(Mesh& mesh, Index e0)
+{
+  auto& es = mesh.m_edges;
+  const Index e1 = es[e0].next, e2 = es[e1].next, e3 = es[e0].oppo;
+  if (e3 == -1) return false;
+  const Index e4 = es[e3].next, e5 = es[e4].next;
+  const Index v0 = es[e0].vert, v1 = es[e1].vert, v2 = es[e2].vert, v3 = es[e5].vert;
+  const Index f0 = es[e0].face, f1 = es[e3].face;
+
+  const Pt p0 = mesh.GetVertPos(v0), p1 = mesh.GetVertPos(v1);
+  const Pt p2 = mesh.GetVertPos(v2), p3 = mesh.GetVertPos(v3);
+  if (Orient2d(p2[0], p2[1], p3[0], p3[1], p1[0], p1[1]) <= 0 || 
+      Orient2d(p3[0], p3[1], p2[0], p2[1], p0[0], p0[1]) <= 0) return false;
+
+  es[e0].SetVertNext(v2, e5);
+  es[e1].next = e0;
+  es[e2].SetNextFace(e4, f1);
+  es[e3].SetVertNext(v3, e2);
+  es[e4].next = e3;
+  es[e5].SetNextFace(e1, f0);
+  mesh.m_faces[f0].edge = e0;
+  mesh.m_faces[f1].edge = e3;
+  mesh.m_verts[v0].edge = e4;
+  mesh.m_verts[v1].edge = e1;
+  mesh.m_verts[v2].edge = e2;
+  mesh.m_verts[v3].edge = e5;
+  return true;
+}
+
+
+
+/*-----------------------------
+* tests
+-----------------------------*/
+
+//every engine and insertion order gives a valid mesh, and the same 
+//triangulation for points in general position
+template <class Mesh>
+static void TestEngines(const char* name)
+{
+  std::vector<Pt> random = RandomPoints(20000, 1);
+
+  //cocircular points (not unique)
+  std::vector<Pt> grid;
+  for (int i = 0; i < 100; ++i) for (int j = 0; j < 100; ++j) grid.push_back({{ 1000.0 + i, 2000.0 + j }});
+
+  const BuildEngine engines[] = { BuildEngine::INCREMENTAL, BuildEngine::DIVIDE_AND_CONQUER, 
+                                  BuildEngine::PARALLEL_INCREMENTAL };
+  const InsertOrder orders [] = { InsertOrder::INPUT, InsertOrder::RANDOM, 
+                                  InsertOrder::HILBERT, InsertOrder::BRIO };
+
+  Mesh ref;
+  ref.InitMesh(random);
+  const std::set<Tri> ref_tris = Triangles(ref);
+
+  bool valid = true, same = true, grid_valid = true;
+  for (BuildEngine engine : engines)
+  {
+    for (InsertOrder order : orders)
+    {
+      Mesh mesh;
+      mesh.InitMesh(random, order, engine);
+      valid = valid && mesh.Validate().IsValid();
+      same  = same  && Triangles(mesh) == ref_tris;
+
+      Mesh g;
+      g.InitMesh(grid, order, engine);
+      grid_valid = grid_valid && g.Validate().IsValid() && 
+                   Triangles(g).size() == 2 * 99 * 99;
+    }
+  }
+
+  char buf[256];
+  std::snprintf(buf, sizeof(buf), "%s engines x orders : Validate", name);
+  Check(valid, buf);
+  std::snprintf(buf, sizeof(buf), "%s engines x orders : same triangulation", name);
+  Check(same, buf);
+  std::snprintf(buf, sizeof(buf), "%s engines x orders : grid", name);
+  Check(grid_valid, buf);
+}
+
+
+
+//RemoveVertex gives the Delaunay triangulation of the remaining points
+static void TestRemoveVertex()
+{
+  std::vector<Pt> ps = RandomPoints(5000, 2);
+  DelaunayMesh mesh;
+  mesh.InitMesh(ps);
+
+  std::vector<char> removed(ps.size(), 0);
+  bool ok = true;
+  for (Index v = 0; v < (Index)ps.size(); v += 3)
+  {
+    if (IsBoundaryVert(mesh, v)) continue;
+    ok = ok && mesh.RemoveVertex(v);
+    removed[v] = 1;
+  }
+
+  std::vector<Pt> rest;
+  for (size_t i = 0; i < ps.size(); ++i) if (!removed[i]) rest.push_back(ps[i]);
+  DelaunayMesh rebuilt;
+  rebuilt.InitMesh(rest);
+
+  Check(ok && mesh.Validate().IsValid(), "RemoveVertex interior : Validate");
+  Check(Triangles(mesh) == Triangles(rebuilt), "RemoveVertex interior : same as rebuild");
+}
+
+
+
+//removing hull verts keeps the mesh convex : the result is the same as a 
+//rebuild, and the removed points (outside of it) can be inserted again
+static void TestRemoveHullVertex()
+{
+  std::vector<Pt> ps = RandomPoints(5000, 3);
+  DelaunayMesh mesh;
+  mesh.InitMesh(ps);
+
+  std::vector<char> removed(ps.size(), 0);
+  std::vector<Pt> back;
+  bool ok = true;
+  for (int round = 0; round < 4; ++round)
+  {
+    for (Index v = 0; v < (Index)ps.size(); ++v)
+    {
+      if (removed[v] || !IsBoundaryVert(mesh, v)) continue;
+      ok = ok && mesh.RemoveVertex(v);
+      removed[v] = 1;
+      back.push_back(ps[v]);
+    }
+  }
+
+  std::vector<Pt> rest;
+  for (size_t i = 0; i < ps.size(); ++i) if (!removed[i]) rest.push_back(ps[i]);
+  DelaunayMesh rebuilt;
+  rebuilt.InitMesh(rest);
+
+  Check(ok && back.size() > 50 && mesh.Validate().IsValid(), "RemoveVertex hull : Validate");
+  Check(Triangles(mesh) == Triangles(rebuilt), "RemoveVertex hull : same as rebuild");
+
+  std::vector<Index> vidx;
+  mesh.InsertPoints(back, -1, vidx);
+  DelaunayMesh full;
+  full.InitMesh(ps);
+  Check(std::count(vidx.begin(), vidx.end(), -1) == 0 && mesh.Validate().IsValid(), 
+        "RemoveVertex hull : insert the points again");
+  Check(Triangles(mesh) == Triangles(full), "RemoveVertex hull : same as the first mesh");
+}
+
+
+
+//segments stay in the mesh, and Refine bounds the angles
+static void TestSegmentsAndRefine()
+{
+  std::vector<Pt> ps = {{ {{ 0, 0 }}, {{ 10, 0 }}, {{ 10, 10 }}, {{ 0, 10 }}, 
+                          {{ 2, 3 }}, {{ 8, 3 }}, {{ 5, 5 }}, {{ 5, 9 }} }};
+  std::vector<Pt> more = RandomPoints(200, 3);
+  for (const Pt& p : more) ps.push_back({{ 1 + 8 * p[0], 4 + 4 * p[1] }});
+
+  DelaunayMesh mesh;
+  mesh.InitMesh(ps);
+  const std::vector<std::array<Index, 2>> segs = {{ {{ 4, 5 }}, {{ 6, 7 }} }};
+  Check(mesh.InsertSegments(segs) == 2, "InsertSegments : inserted");
+
+  const Index num = mesh.Refine(20.0, 0, 100000);
+  Index constrained = 0;
+  for (Index e : mesh.Edges()) if (mesh.m_edges[e].IsConstrained()) ++constrained;
+
+  const ValidationReport report = mesh.Validate();
+  Check(report.IsValid(), "Refine : Validate (constrained Delaunay)");
+  Check(0 < num && num < 100000, "Refine : terminated");
+  Check(constrained >= 4, "Refine : segments kept");
+  Check(MinAngle(mesh) >= 20.0 - 1e-9, "Refine : min angle >= 20");
+}
+
+
+//hull edges as segments in both directions (the one along the incoming 
+//boundary edge of v0 is not a spoke of v0), and their endpoints are kept
+static void TestHullSegments()
+{
+  const std::vector<Pt> ps = {{ {{ 0, 0 }}, {{ 10, 0 }}, {{ 10, 10 }}, {{ 0, 10 }}, {{ 3, 4 }}, {{ 7, 6 }} }};
+  bool inserted = true, kept = true;
+  for (int dir = 0; dir < 2; ++dir)
+  {
+    for (Index i = 0; i < 4; ++i)
+    {
+      const Index a = dir ? (i + 1) % 4 : i;
+      const Index b = dir ? i : (i + 1) % 4;
+      DelaunayMesh mesh;
+      std::vector<Pt> qs = ps;
+      mesh.InitMesh(qs);
+      inserted = inserted && mesh.InsertSegment(a, b);
+
+      Index num = 0;
+      for (Index e : mesh.Edges()) if (mesh.m_edges[e].IsConstrained()) ++num;
+      inserted = inserted && num == 1;
+      kept = kept && !mesh.RemoveVertex(a) && !mesh.RemoveVertex(b) && mesh.Validate().IsValid();
+    }
+  }
+  Check(inserted, "InsertSegment hull edges : both directions");
+  Check(kept, "RemoveVertex hull segment : endpoints kept");
+}
+
+
+
+//InitByVsFs on a fan of valence 100000 (all of its edges are in the bucket 
+//of the center), faces in random order
+static void TestInitByVsFsFan()
+{
+  const Index N = 100000;
+  const double PI = 3.14159265358979323846;
+  std::vector<Pt> ps(N + 1);
+  std::vector<std::array<Index, 3>> faces(N);
+  ps[0] = {{ 0, 0 }};
+  for (Index i = 0; i < N; ++i)
+  {
+    ps[i + 1] = {{ std::cos(2 * PI * i / N), std::sin(2 * PI * i / N) }};
+    faces[i]  = {{ 0, i + 1, (i + 1) % N + 1 }};
+  }
+  std::shuffle(faces.begin(), faces.end(), std::mt19937(6));
+
+  DelaunayMesh mesh;
+  mesh.InitByVsFs(ps, faces);
+  Index num_boundary = 0;
+  for (Index e : mesh.Edges()) if (mesh.m_edges[e].oppo == -1) ++num_boundary;
+  Check(num_boundary == N && mesh.Validate().IsValid(), "InitByVsFs fan : twins matched");
+}
+
+
+
+//MakeDelaunay (serial and parallel) restores the triangulation of InitMesh 
+//from a mesh scrambled by random legal flips (of its indexed face list)
+static void TestMakeDelaunay()
+{
+  std::vector<Pt> ps = RandomPoints(20000, 7);
+  DelaunayMesh ref;
+  ref.InitMesh(ps);
+
+  std::vector<std::array<Index, 3>> faces;
+  std::map<std::pair<Index, Index>, Index> face_of; // half edge (a,b) -> face
+  for (Index f : ref.Faces())
+  {
+    const Index e0 = ref.m_faces[f].edge;
+    const Index e1 = ref.m_edges[e0].next;
+    const Index e2 = ref.m_edges[e1].next;
+    faces.push_back({{ ref.m_edges[e0].vert, ref.m_edges[e1].vert, ref.m_edges[e2].vert }});
+  }
+  for (Index f = 0; f < (Index)faces.size(); ++f)
+    for (int k = 0; k < 3; ++k) face_of[{ faces[f][k], faces[f][(k + 1) % 3] }] = f;
+
+  //flip (a,b) of f = (a,b,c) and g = (b,a,d) into (c,a,d), (d,b,c) if convex
+  std::mt19937 rng(8);
+  Index num_flips = 0;
+  for (int i = 0; i < 200000; ++i)
+  {
+    const Index f = rng() % faces.size();
+    const int   k = rng() % 3;
+    const Index a = faces[f][k], b = faces[f][(k + 1) % 3], c = faces[f][(k + 2) % 3];
+    const auto it = face_of.find({ b, a });
+    if (it == face_of.end()) continue;
+    const Index g = it->second;
+    Index d = -1;
+    for (Index v : faces[g]) if (v != a && v != b) d = v;
+    if (Orient2d(ps[c][0], ps[c][1], ps[a][0], ps[a][1], ps[d][0], ps[d][1]) <= 0 ||
+        Orient2d(ps[d][0], ps[d][1], ps[b][0], ps[b][1], ps[c][0], ps[c][1]) <= 0) continue;
+
+    face_of.erase({ a, b });
+    face_of.erase({ b, a });
+    faces[f] = {{ c, a, d }};
+    faces[g] = {{ d, b, c }};
+    for (Index h : { f, g })
+      for (int j = 0; j < 3; ++j) face_of[{ faces[h][j], faces[h][(j + 1) % 3] }] = h;
+    ++num_flips;
+  }
+
+  const std::set<Tri> ref_tris = Triangles(ref);
+  bool ok = num_flips > 50000;
+  for (bool parallel : { false, true })
+  {
+    DelaunayMesh mesh;
+    mesh.InitByVsFs(ps, faces);
+    ok = ok && !mesh.Validate().IsValid();
+    ok = ok && mesh.MakeDelaunay(parallel) > 0;
+    ok = ok && mesh.Validate().IsValid() && Triangles(mesh) == ref_tris;
+
+    //the edges of the verts are set (same valence as InitMesh)
+    for (Index v = 0; v < (Index)ps.size(); ++v)
+    {
+      Index n = 0, n_ref = 0;
+      for (Index e : mesh.OutEdges(v)) if (mesh.m_edges[e].vert == v) ++n;
+      for (Index e : ref .OutEdges(v)) { (void)e; ++n_ref; }
+      ok = ok && n == n_ref;
+    }
+    Check(ok, parallel ? "MakeDelaunay parallel : same as InitMesh" : "MakeDelaunay serial : same as InitMesh");
+  }
+}
+
+
+
+//CornerTableMesh round trip into a reused mesh (with tombstones) keeps the 
+//faces and segments, and the mesh can be edited after it
+static void TestCornerTable()
+{
+  std::vector<Pt> ps = RandomPoints(3000, 9);
+  DelaunayMesh mesh;
+  mesh.InitMesh(ps);
+  const std::vector<std::array<Index, 2>> segs = {{ {{ 0, 1 }}, {{ 2, 3 }}, {{ 4, 5 }} }};
+  mesh.InsertSegments(segs);
+  for (Index v = 10; v < 3000; v += 7) if (!IsBoundaryVert(mesh, v)) mesh.RemoveVertex(v);
+
+  std::vector<Pt> qs = RandomPoints(2000, 10);
+  DelaunayMesh reused;
+  reused.InitMesh(qs);
+  for (Index v = 0; v < 2000; v += 3) if (!IsBoundaryVert(reused, v)) reused.RemoveVertex(v);
+
+  CornerTableMesh ct;
+  ct.Set(mesh);
+  ct.Get(reused);
+
+  Index num = 0, num_ref = 0;
+  for (Index e : mesh  .Edges()) if (mesh  .m_edges[e].IsConstrained()) ++num_ref;
+  for (Index e : reused.Edges()) if (reused.m_edges[e].IsConstrained()) ++num;
+  Check(num == num_ref && num > 0 && Triangles(reused) == Triangles(mesh) && reused.Validate().IsValid(), 
+        "CornerTableMesh : round trip");
+
+  //points inside and outside of the hull
+  std::vector<Pt> more = RandomPoints(500, 11);
+  for (Pt& p : more) p = {{ 1.2 * p[0] - 0.1, 1.2 * p[1] - 0.1 }};
+  std::vector<Index> vidx;
+  reused.InsertPoints(more, -1, vidx);
+  for (Index v = 0; v < 3000; v += 5) if (!IsBoundaryVert(reused, v)) reused.RemoveVertex(v);
+  Check(std::count(vidx.begin(), vidx.end(), -1) == 0 && reused.Validate().IsValid(), 
+        "CornerTableMesh : insert / remove after Get");
+}
+
+
+
+//ValidateDirty checks only the edges around the last edits : insertion, 
+//removal, Lloyd steps, and a non Delaunay flip next to an insertion
+static void TestValidateDirty()
+{
+  std::vector<Pt> ps = RandomPoints(20000, 12);
+  DelaunayMesh mesh;
+  mesh.InitMesh(ps);
+  mesh.SetDirtyTracking(true);
+  const Index E = mesh.Validate().num_edges;
+  Check(mesh.ValidateDirty().num_edges == E, "ValidateDirty : first call checks all");
+
+  bool ok = true;
+  std::vector<Index> vidx;
+  mesh.InsertPoints(RandomPoints(10, 13), -1, vidx);
+  ValidationReport rep = mesh.ValidateDirty();
+  ok = ok && rep.IsValid() && 0 < rep.num_edges && rep.num_edges < 1000;
+
+  for (Index v = 0; v < 100; v += 10) if (!IsBoundaryVert(mesh, v)) mesh.RemoveVertex(v);
+  rep = mesh.ValidateDirty();
+  ok = ok && rep.IsValid() && 0 < rep.num_edges && rep.num_edges < 1000;
+
+  mesh.LloydRelaxation(1);
+  ok = ok && mesh.ValidateDirty().IsValid() && mesh.ValidateDirty().num_edges == 0;
+  Check(ok, "ValidateDirty : insert / remove / Lloyd");
+
+  //flip an edge of a face next to the star of a new vert (the faces on 
+  //both sides of its link edges are checked)
+  mesh.InsertPoints({{ {{ 0.5, 0.5 }} }}, -1, vidx);
+  Index flipped = -1;
+  for (Index s : mesh.OutEdges(vidx[0]))
+  {
+    const Index t = mesh.m_edges[mesh.m_edges[s].next].oppo;
+    if (t == -1) continue;
+    for (Index x : { (Index)mesh.m_edges[t].next, (Index)mesh.m_edges[mesh.m_edges[t].next].next })
+      if (flipped < 0 && FlipByHand(mesh, x)) flipped = x;
+  }
+  rep = mesh.ValidateDirty();
+  const Index o = mesh.m_edges[flipped].oppo;
+  const bool found = std::binary_search(rep.bad_edges.begin(), rep.bad_edges.end(), flipped) ||
+                     std::binary_search(rep.bad_edges.begin(), rep.bad_edges.end(), o);
+  Check(flipped >= 0 && rep.num_non_delaunay == 1 && found && rep.num_edges < 100, 
+        "ValidateDirty : finds a bad flip");
+}
+
+
+
+//Compact after removals : no tombstones are left, and new_vidx maps the 
+//verts to their positions
+static void TestCompact()
+{
+  std::vector<Pt> ps = RandomPoints(5000, 14);
+  DelaunayMesh mesh;
+  mesh.InitMesh(ps);
+  std::vector<char> removed(ps.size(), 0);
+  for (Index v = 0; v < 5000; v += 4) 
+    if (!IsBoundaryVert(mesh, v)) removed[v] = mesh.RemoveVertex(v);
+  const std::set<Tri> tris = Triangles(mesh);
+
+  std::vector<Index> new_vidx;
+  mesh.Compact(new_vidx);
+  bool mapped = new_vidx.size() == ps.size();
+  for (Index v = 0; v < (Index)ps.size() && mapped; ++v)
+  {
+    if (removed[v]) mapped = new_vidx[v] == -1;
+    else            mapped = new_vidx[v] >= 0 && mesh.GetVertPos(new_vidx[v]) == ps[v];
+  }
+
+  Index live = 0;
+  for (Index f : mesh.Faces()) { (void)f; ++live; }
+  Check(mesh.Validate().IsValid() && live == (Index)mesh.m_faces.size() && 
+        (Index)mesh.m_edges.size() == 3 * live && Triangles(mesh) == tris, "Compact : Validate, no tombstones");
+  Check(mapped, "Compact : new_vidx");
+}
+
+
+
+//VoronoiView cells : each cell is the faces around its vert, closed cells 
+//have the areas of CalcCVTEnergy, boundary verts have open cells
+static void TestVoronoiView()
+{
+  std::vector<Pt> ps = RandomPoints(5000, 15);
+  DelaunayMesh mesh;
+  mesh.InitMesh(ps);
+
+  VoronoiView vv;
+  vv.Set(mesh);
+  std::vector<double> area, cvt_area;
+  std::vector<Pt> grad;
+  vv.CalcCellAreas(area);
+  mesh.CalcCVTEnergy({}, grad, cvt_area);
+
+  bool same = vv.NumCells() == (Index)ps.size() && area.size() == cvt_area.size();
+  Index closed = 0;
+  for (Index v = 0; v < (Index)ps.size() && same; ++v)
+  {
+    std::set<Index> star, cell;
+    for (Index e : mesh.OutEdges(v)) star.insert(mesh.m_edges[e].face);
+    for (Index i = vv.CellBegin(v); i < vv.CellEnd(v); ++i) cell.insert(vv.m_cell[i]);
+
+    same = star == cell && vv.CellSize(v) == (Index)star.size() && 
+           vv.IsOpen(v) == IsBoundaryVert(mesh, v) && 
+           std::fabs(area[v] - cvt_area[v]) <= 1e-9 * std::max(1e-3, cvt_area[v]);
+    if (area[v] > 0) ++closed;
+  }
+  Check(same && closed > 4500, "VoronoiView : cell areas");
+}
+
+
+
+//OptimizeCVT lowers the CVT energy (clipped by the unit square) and keeps 
+//a valid mesh
+static void TestOptimizeCVT()
+{
+  std::vector<Pt> ps = RandomPoints(3000, 16);
+  DelaunayMesh mesh;
+  mesh.InitMesh(ps);
+
+  const std::vector<Pt> clip = {{ {{ 0, 0 }}, {{ 1, 0 }}, {{ 1, 1 }}, {{ 0, 1 }} }};
+  std::vector<Pt> grad;
+  std::vector<double> area;
+  const double before = mesh.CalcCVTEnergy(clip, grad, area);
+  const int iterations = mesh.OptimizeCVT(20, clip);
+  const double after = mesh.CalcCVTEnergy(clip, grad, area);
+
+  Check(iterations > 0 && after < before, "OptimizeCVT : energy decreases");
+  Check(mesh.Validate().IsValid(), "OptimizeCVT : Validate");
+}
+
+
+
+//C shaped mesh : jittered grid on [0,10]^2, then the faces in the notch 
+//(x > 3, 4 < y < 6) are dropped by InitByVsFs
+static void MakeCMesh(DelaunayMesh& mesh)
+{
+  std::vector<Pt> ps = RandomPoints(400, 4);
+  for (int i = 0; i < 400; ++i) ps[i] = {{ (i % 20 + 0.2 + 0.6 * ps[i][0]) / 2, (i / 20 + 0.2 + 0.6 * ps[i][1]) / 2 }};
+  DelaunayMesh full;
+  full.InitMesh(ps);
+
+  std::vector<std::array<Index, 3>> faces;
+  for (Index f : full.Faces())
+  {
+    const Index e0 = full.m_faces[f].edge;
+    const Index e1 = full.m_edges[e0].next;
+    const Index e2 = full.m_edges[e1].next;
+    const std::array<Index, 3> t = {{ full.m_edges[e0].vert, full.m_edges[e1].vert, full.m_edges[e2].vert }};
+    double cx = 0, cy = 0;
+    for (Index v : t) { cx += ps[v][0] / 3; cy += ps[v][1] / 3; }
+    if (cx > 3 && 4 < cy && cy < 6) continue;
+    faces.push_back(t);
+  }
+  mesh.InitByVsFs(ps, faces);
+}
+
+
+
+//InsertPoints into a non convex mesh : points inside of live faces are 
+//inserted even if the walk leaves the mesh through the notch
+static void TestInsertConcave()
+{
+  DelaunayMesh mesh;
+  MakeCMesh(mesh);
+
+  //alternate between the two arms, and some points in the notch
+  std::vector<Pt> qs;
+  std::vector<Pt> rs = RandomPoints(200, 5);
+  for (int i = 0; i < 200; ++i)
+  {
+    const double x = 4 + 5.5 * rs[i][0];
+    if      (i % 10 == 9) qs.push_back({{ x, 4.8 + 0.4 * rs[i][1] }});
+    else if (i % 2  == 0) qs.push_back({{ x, 7 + 2.5 * rs[i][1] }});
+    else                  qs.push_back({{ x, 0.5 + 2.5 * rs[i][1] }});
+  }
+
+  //expected : strictly inside of a live face (brute force)
+  std::vector<char> inside(qs.size(), 0);
+  for (size_t i = 0; i < qs.size(); ++i)
+  {
+    for (Index f : mesh.Faces())
+    {
+      const Index e0 = mesh.m_faces[f].edge;
+      const Index e1 = mesh.m_edges[e0].next;
+      const Index e2 = mesh.m_edges[e1].next;
+      const Pt a = mesh.GetVertPos(mesh.m_edges[e0].vert);
+      const Pt b = mesh.GetVertPos(mesh.m_edges[e1].vert);
+      const Pt c = mesh.GetVertPos(mesh.m_edges[e2].vert);
+      const Pt& q = qs[i];
+      if (Orient2d(a[0], a[1], b[0], b[1], q[0], q[1]) > 0 && 
+          Orient2d(b[0], b[1], c[0], c[1], q[0], q[1]) > 0 && 
+          Orient2d(c[0], c[1], a[0], a[1], q[0], q[1]) > 0) inside[i] = 1;
+    }
+  }
+
+  std::vector<Index> vidx;
+  mesh.InsertPoints(qs, -1, vidx);
+  bool all = true, none_outside = true;
+  int num_inside = 0;
+  for (size_t i = 0; i < qs.size(); ++i)
+  {
+    num_inside += inside[i];
+    if ( inside[i] && vidx[i] <  0) all = false;
+    if (!inside[i] && vidx[i] >= 0) none_outside = false;
+  }
+  Check(num_inside > 150 && all, "InsertPoints concave : points inside are inserted");
+  Check(none_outside, "InsertPoints concave : points outside are rejected");
+  Check(mesh.Validate().IsValid(), "InsertPoints concave : Validate");
+}
+
+
+
+//LloydRelaxation on a non convex mesh : vert 0 (star p0,p1,r,p2) is the 
+//only free vert, its one ring average (-9.75,0.1) is in face (p1,p2,g) behind
+//the hole (p1,c,p2,g), so the walk from its star leaves the mesh through the
+//hole. r is fixed by segment r-c, the other verts are on the boundary
+static void TestLloydConcave()
+{
+  const std::vector<Pt> ps = {{ {{ 0, 0 }}, {{ 2, 0.4 }}, {{ -20, 6 }}, {{ -1, 0 }}, {{ -20, -6 }}, 
+    {{ -5, 0 }}, {{ -8, 0 }}, {{ 5, 15 }}, {{ -35, 15 }}, {{ -35, -15 }}, {{ 5, -15 }} }};
+  const std::vector<std::array<Index, 3>> faces = {{ 
+    {{ 0, 1, 2 }}, {{ 0, 2, 3 }}, {{ 0, 3, 4 }}, {{ 0, 4, 1 }}, {{ 3, 2, 5 }}, {{ 3, 5, 4 }}, 
+    {{ 2, 4, 6 }}, {{ 1, 7, 8 }}, {{ 1, 8, 2 }}, {{ 2, 8, 9 }}, {{ 2, 9, 4 }}, {{ 4, 9, 10 }}, 
+    {{ 4, 10, 1 }} }};
+  DelaunayMesh mesh;
+  mesh.InitByVsFs(ps, faces);
+  mesh.InsertSegment(3, 5);
+  const Index num_bad = mesh.Validate().num_non_delaunay;
+  mesh.LloydRelaxation(1);
+
+  const Pt p = mesh.GetVertPos(0);
+  Check(mesh.GetUnmovedVertCount() == 0 && p[0] < -8, "LloydRelaxation concave : moved behind a hole");
+
+  //some ring faces are not Delaunay (InitByVsFs keeps them as given)
+  const ValidationReport rep = mesh.Validate();
+  Check(rep.num_topology == 0 && rep.num_inverted == 0 && rep.num_non_delaunay <= num_bad, 
+        "LloydRelaxation concave : Validate");
+}
+
+
+
+//Refine on a non convex mesh : C shaped 10x10 grid (the notch is x > 3, 
+//4 < y < 6), refined by angle and area
+static void TestRefineConcave()
+{
+  std::vector<Pt> ps;
+  std::vector<std::array<Index, 3>> faces;
+  for (int j = 0; j <= 10; ++j) 
+    for (int i = 0; i <= 10; ++i) ps.push_back({{ (double)i, (double)j }});
+  for (int j = 0; j < 10; ++j) 
+  {
+    for (int i = 0; i < 10; ++i)
+    {
+      if (i >= 3 && 4 <= j && j < 6) continue;
+      const Index a = j * 11 + i, b = a + 1, c = a + 12, d = a + 11;
+      faces.push_back({{ a, b, c }});
+      faces.push_back({{ a, c, d }});
+    }
+  }
+  DelaunayMesh mesh;
+  mesh.InitByVsFs(ps, faces);
+  const Index num = mesh.Refine(30, 0.01, 100000);
+
+  Check(0 < num && num < 100000, "Refine concave : terminated");
+  Check(mesh.GetRefineDropCount() == 0, "Refine concave : no dropped circumcenters");
+  Check(mesh.Validate().IsValid(), "Refine concave : Validate");
+  Check(MinAngle(mesh) >= 30.0 - 1e-9, "Refine concave : min angle >= 30");
+}
+
+
+
+int main()
+{
+  TestEngines<DelaunayMesh  >("double");
+  TestEngines<DelaunayMeshF >("float ");
+  TestEngines<DelaunayMesh64>("int64 ");
+  TestRemoveVertex();
+  TestRemoveHullVertex();
+  TestSegmentsAndRefine();
+  TestHullSegments();
+  TestInitByVsFsFan();
+  TestMakeDelaunay();
+  TestCornerTable();
+  TestValidateDirty();
+  TestCompact();
+  TestVoronoiView();
+  TestOptimizeCVT();
+  TestInsertConcave();
+  TestLloydConcave();
+  TestRefineConcave();
+
+  std::printf("%s\n", g_failed ? "FAILED" : "all passed");
+  return g_failed ? 1 : 0;
+}